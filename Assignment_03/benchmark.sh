@@ -0,0 +1,94 @@
+#!/bin/sh
+# Runs a mix of synthetic jobs under the SimpleScheduler for every NCPU and
+# TSLICE combination, and once directly under the kernel scheduler, and
+# compares throughput, fairness and CPU overhead.
+# Usage: ./benchmark.sh [NCPU list] [TSLICE(ms) list] [jobs per type] [scheduler options...]
+# Lists are comma separated, e.g. ./benchmark.sh 1,2,4 1,10,50 4
+NCPUS=$(echo "${1:-1,2,4}" | tr ',' ' ')
+TSLICES=$(echo "${2:-1,10,50}" | tr ',' ' ')
+PER_TYPE=${3:-4}
+shift 3 2>/dev/null || shift $#
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Each job with the time it needs on an idle machine (CPU + I/O), in ms
+i=0
+while [ "$i" -lt "$PER_TYPE" ]; do
+    echo "./cpu_bound 200"
+    echo "./io_bound 20 10"
+    echo "./mixed 10 10 10"
+    echo "./bursty 8 20 30"
+    i=$((i + 1))
+done > "$WORK/jobs"
+sed 's/^/submit /' "$WORK/jobs" > "$WORK/input"
+NJOBS=$(wc -l < "$WORK/jobs")
+
+# Reads "turnaround_ms command..." lines; prints Jain's index of the
+# normalised service rates demand / turnaround (1 = perfectly fair)
+jain() {
+    awk '{
+        split($0, f, " ")
+        program = f[2]; sub(".*/", "", program)
+        if (program == "cpu_bound") demand = f[3]
+        else if (program == "io_bound") demand = f[3] * (f[4] + 0.1)
+        else demand = f[3] * (f[4] + f[5]) # mixed and bursty
+        x = demand / $1
+        sum += x; squares += x * x; jobs++
+    } END { printf "%.3f", (jobs > 0 ? sum * sum / (jobs * squares) : 0) }'
+}
+
+# "user sys" children times from the shell's times builtin, in ms
+children_cpu_ms() {
+    tail -1 | awk '{
+        split($1, u, "m"); split($2, s, "m")
+        printf "%.0f", (u[1] * 60 + u[2] + s[1] * 60 + s[2]) * 1000
+    }'
+}
+
+now_ns() {
+    date +%s%N
+}
+
+printf "%-9s %4s %6s %8s %7s %6s %8s %9s %8s\n" \
+    mode ncpu tslice wall_ms jobs/s jain cpu_ms tick_us signals
+
+# Baseline: every job started at once and left to the kernel
+START=$(now_ns)
+(
+    while read -r cmd; do
+        (
+            s=$(now_ns)
+            $cmd
+            e=$(now_ns)
+            echo "$(( (e - s) / 1000000 )) $cmd" >> "$WORK/direct"
+        ) &
+    done < "$WORK/jobs"
+    wait
+    times > "$WORK/direct_times"
+)
+END=$(now_ns)
+DIRECT_MS=$(( (END - START) / 1000000 ))
+DIRECT_CPU=$(children_cpu_ms < "$WORK/direct_times")
+printf "%-9s %4s %6s %8d %7.1f %6s %8s %9s %8s\n" direct - - "$DIRECT_MS" \
+    "$(echo "$NJOBS $DIRECT_MS" | awk '{ print $1 * 1000 / $2 }')" "$(jain < "$WORK/direct")" "$DIRECT_CPU" - -
+
+for NCPU in $NCPUS; do
+    for TSLICE in $TSLICES; do
+        START=$(now_ns)
+        (
+            TERM=dumb ./scheduler "$NCPU" "$TSLICE" --jobs-csv "$WORK/jobs.csv" "$@" < "$WORK/input" > "$WORK/out"
+            times > "$WORK/sched_times"
+        )
+        END=$(now_ns)
+        WALL_MS=$(( (END - START) / 1000000 ))
+        # turnaround_ms followed by the command, from the scheduler's job CSV
+        tail -n +2 "$WORK/jobs.csv" | awk -F, '{ cmd = $9; gsub("\"", "", cmd); print $6, cmd }' > "$WORK/sched"
+        TICK_US=$(grep -ao 'Scheduling overhead per tick: mean [0-9.]*' "$WORK/out" | awk '{ print $NF }')
+        SIGNALS=$(grep -ao '[0-9]* signals total' "$WORK/out" | awk '{ print $1 }')
+        printf "%-9s %4d %6s %8d %7.1f %6s %8s %9s %8s\n" scheduler "$NCPU" "$TSLICE" "$WALL_MS" \
+            "$(echo "$NJOBS $WALL_MS" | awk '{ print $1 * 1000 / $2 }')" "$(jain < "$WORK/sched")" \
+            "$(children_cpu_ms < "$WORK/sched_times")" "$TICK_US" "$SIGNALS"
+    done
+done
+echo "$NJOBS jobs; cpu_ms is the CPU used by the jobs plus the scheduler, compare with direct ($DIRECT_CPU ms)"
@@ -0,0 +1,19 @@
+#include "workload.h"
+#include "dummy_main.h"
+
+/*
+ * bursty [rounds] [burst_ms] [idle_ms]: idle periods broken by CPU bursts
+ * whose length cycles through 1/4, 1/2, 1 and 9/4 of burst_ms, so the mean
+ * burst is burst_ms but a job never settles into one pattern.
+ */
+int main(int argc, char **argv) {
+    static const double scale[] = {0.25, 0.5, 1.0, 2.25};
+    int rounds = (int)arg_ms(argc, argv, 1, 8);
+    double burst_ms = arg_ms(argc, argv, 2, 20);
+    double idle_ms = arg_ms(argc, argv, 3, 30);
+    for (int i = 0; i < rounds; i++) {
+        wait_io_ms(idle_ms);
+        burn_cpu_ms(burst_ms * scale[i % 4]);
+    }
+    return 0;
+}
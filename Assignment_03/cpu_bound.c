@@ -0,0 +1,8 @@
+#include "workload.h"
+#include "dummy_main.h"
+
+// cpu_bound [cpu_ms]: one uninterrupted CPU burst
+int main(int argc, char **argv) {
+    burn_cpu_ms(arg_ms(argc, argv, 1, 200));
+    return 0;
+}
@@ -6,7 +6,9 @@ int dummy_main(int argc, char **argv);
 int main(int argc, char **argv) {
     // Custom code to support scheduling:
     signal(SIGCONT, SIG_DFL);  // Ensure SIGCONT resumes execution
-    pause();  // Wait until SIGCONT to start
+    // No pause() here: SimpleScheduler holds the job back before exec until
+    // its first time slice, and with SIGCONT at SIG_DFL no signal would ever
+    // wake a second pause(), so the job would hang holding its CPU slot.
 
     // Call the actual program’s main function, now renamed to dummy_main
     int ret = dummy_main(argc, argv);
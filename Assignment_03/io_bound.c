@@ -0,0 +1,13 @@
+#include "workload.h"
+#include "dummy_main.h"
+
+// io_bound [rounds] [io_ms]: mostly waiting, with a short CPU burst per round
+int main(int argc, char **argv) {
+    int rounds = (int)arg_ms(argc, argv, 1, 20);
+    double io_ms = arg_ms(argc, argv, 2, 10);
+    for (int i = 0; i < rounds; i++) {
+        burn_cpu_ms(0.1);
+        wait_io_ms(io_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef JOB_RING_H
+#define JOB_RING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+/*
+ * Single-producer/single-consumer ring of job submissions shared between the
+ * shell (producer) and the forked scheduler process (consumer).
+ *
+ * The ring lives in a MAP_SHARED anonymous mapping created before the fork,
+ * so both processes see the same memory. head is only written by the shell
+ * and tail only by the scheduler; a release store on one side paired with an
+ * acquire load on the other is all the synchronisation needed. The eventfd,
+ * also inherited across the fork, wakes the scheduler when it is waiting.
+ */
+
+#define JOB_RING_SIZE 1024 // must be a power of two
+
+typedef struct {
+    pid_t pid;
+    int priority;
+    int shares;
+    long arrival_us; // CLOCK_MONOTONIC time a batch job is due, 0 to enqueue at once
+    struct timespec submit_time; // CLOCK_MONOTONIC
+} job_record;
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t head; // next slot the shell fills
+    _Alignas(64) _Atomic uint32_t tail; // next slot the scheduler reads
+    _Alignas(64) int event_fd;
+    job_record slots[JOB_RING_SIZE];
+} job_ring;
+
+static inline job_ring *job_ring_create(void) {
+    job_ring *ring = mmap(NULL, sizeof(job_ring), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        perror("mmap job ring");
+        exit(1);
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ring->event_fd == -1) {
+        perror("eventfd");
+        exit(1);
+    }
+    return ring;
+}
+
+// Producer side; returns false if the scheduler has fallen a full ring behind
+static inline bool job_ring_push(job_ring *ring, const job_record *job) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == JOB_RING_SIZE) return false;
+    ring->slots[head & (JOB_RING_SIZE - 1)] = *job;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Wakes the scheduler; one call covers any number of preceding pushes
+static inline void job_ring_notify(job_ring *ring) {
+    eventfd_write(ring->event_fd, 1);
+}
+
+// Consumer side; returns false when the ring is empty
+static inline bool job_ring_pop(job_ring *ring, job_record *job) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head) return false;
+    *job = ring->slots[tail & (JOB_RING_SIZE - 1)];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// Clears a pending notification before the scheduler drains the ring
+static inline void job_ring_clear_notify(job_ring *ring) {
+    eventfd_t value;
+    eventfd_read(ring->event_fd, &value);
+}
+
+#endif
@@ -0,0 +1,14 @@
+#include "workload.h"
+#include "dummy_main.h"
+
+// mixed [rounds] [cpu_ms] [io_ms]: alternating CPU bursts and I/O waits
+int main(int argc, char **argv) {
+    int rounds = (int)arg_ms(argc, argv, 1, 10);
+    double cpu_ms = arg_ms(argc, argv, 2, 10);
+    double io_ms = arg_ms(argc, argv, 3, 10);
+    for (int i = 0; i < rounds; i++) {
+        burn_cpu_ms(cpu_ms);
+        wait_io_ms(io_ms);
+    }
+    return 0;
+}
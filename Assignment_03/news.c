@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -8,9 +9,20 @@
 #include <sys/time.h>
 #include <time.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <getopt.h>
+#include "job_ring.h"
+#include "policy.h"
+#include "pidfd.h"
 
 #define BUFFER_SIZE 100
-#define HISTORY_SIZE 100
+#define INITIAL_JOBS 64 // table capacity before the first doubling
+#define PID_BUCKETS 1024 // pid lookup buckets for jobs without a pidfd, a power of two
+#define OPT_BATCH 0x200 // after the policy options
 
 typedef struct {
     char* command;
@@ -18,28 +30,66 @@ typedef struct {
     struct timeval start_time;
     long duration;
     bool completed;
+    int pid_fd; // pidfd in exit_epoll_fd until the job is reaped, -1 without one
+    int pid_next; // next history index in the job's pid_buckets chain, -1 at the end
 } command_info;
 
-command_info command_history[HISTORY_SIZE];
+command_info *command_history;
 int history_count = 0;
+int history_capacity = 0;
+int exit_epoll_fd = -1; // the shell's pidfds, readable once a job has exited
+int watched_jobs = 0; // open pidfds in exit_epoll_fd
+int unwatched_jobs = 0; // jobs without a pidfd that have not completed, found through pid_buckets
+int pid_buckets[PID_BUCKETS]; // history index of the first unwatched job per pid hash, -1 if none
+volatile sig_atomic_t child_exited = 0;
 
 int NCPU;
 int TSLICE;
-int ready_queue[HISTORY_SIZE];
-int rq_front = 0, rq_rear = -1, rq_size = 0;
+// Jobs known to the scheduler process and the CPU slots they run on
+typedef struct {
+    pid_t pid;
+    int slot;    // CPU slot the job holds, -1 when it has none
+    bool on_cpu; // last signal sent was SIGCONT
+    bool exited;
+    int pid_fd;  // watched by the scheduler's epoll until the job exits, -1 without one
+    sched_job sj;
+} scheduled_job;
+
+// Allocated one by one so running_jobs and the run queues can keep pointers
+scheduled_job **sched_jobs;
+int sched_job_count = 0;
+int sched_job_capacity = 0;
+scheduled_job **running_jobs;
+sched_policy *policy;
+bool measure_runtime = false; // fair policy: charge jobs their measured CPU time
 pid_t scheduler_pid;
 
-void enqueue(int pid) {
-    ready_queue[++rq_rear % HISTORY_SIZE] = pid;
-    rq_size++;
-}
+// Submissions travel from the shell to the scheduler process through this ring
+job_ring *submit_ring;
+volatile sig_atomic_t scheduler_stop = 0;
+long submit_count = 0;
+long submit_latency_sum_ns = 0;
+long submit_latency_max_ns = 0;
+int scheduler_epoll_fd;
+int scheduler_pidfds = 0;
 
-int dequeue() {
-    if (rq_size == 0) return -1;
-    int pid = ready_queue[rq_front++ % HISTORY_SIZE];
-    rq_size--;
-    return pid;
-}
+// Batch jobs the scheduler holds back until their arrival time
+typedef struct {
+    long arrival_us; // CLOCK_MONOTONIC
+    scheduled_job *job;
+} pending_arrival;
+
+pending_arrival *arrivals; // sorted by arrival_us from next_arrival on
+int narrivals = 0;
+int next_arrival = 0;
+int arrivals_capacity = 0;
+
+// Tags in epoll_event.data.u32 of the scheduler process
+enum {
+    EV_SUBMIT,
+    EV_TICK,
+    EV_JOB_EXIT, // EV_JOB_EXIT + i is the pidfd of sched_jobs[i]
+};
 
 void sigint_handler(int sig_num) {
     printf("\nReceived Ctrl+C. Displaying command info...\n");
@@ -61,29 +111,117 @@ void sigint_handler(int sig_num) {
         free(command_history[i].command);
     }
 
+    // Jobs run in their own process groups, out of reach of the terminal's
+    // Ctrl+C, so end them here. SIGCONT lets stopped ones act on the SIGTERM;
+    // jobs still waiting to exec are ended by the SIGTERM alone.
     kill(scheduler_pid, SIGTERM);
+    for (int i = 0; i < history_count; i++) {
+        if (command_history[i].completed) continue;
+        killpg(command_history[i].pid, SIGTERM);
+        killpg(command_history[i].pid, SIGCONT);
+    }
     exit(0);
 }
 
+void record_exit(command_info *job) {
+    struct timeval end_time;
+    gettimeofday(&end_time, NULL);
+    job->duration = (end_time.tv_sec - job->start_time.tv_sec) * 1000 +
+                    (end_time.tv_usec - job->start_time.tv_usec) / 1000;
+    job->completed = true;
+    if (job->pid_fd >= 0) {
+        // Jobs still waiting to exec hold copies of the pidfd, so close() alone would leave it registered
+        epoll_ctl(exit_epoll_fd, EPOLL_CTL_DEL, job->pid_fd, NULL);
+        close(job->pid_fd);
+        job->pid_fd = -1;
+        watched_jobs--;
+    }
+    else {
+        unwatched_jobs--;
+    }
+}
+
+// Jobs without a pidfd, so a pid from waitpid(-1) finds its entry without a scan
+void unwatched_add(int index) {
+    int *bucket = &pid_buckets[command_history[index].pid & (PID_BUCKETS - 1)];
+    command_history[index].pid_next = *bucket;
+    *bucket = index;
+}
+
+// Removes and returns the history index of the unwatched job with this pid, -1 if none
+int unwatched_take(pid_t pid) {
+    for (int *link = &pid_buckets[pid & (PID_BUCKETS - 1)]; *link != -1; link = &command_history[*link].pid_next) {
+        if (command_history[*link].pid == pid) {
+            int index = *link;
+            *link = command_history[index].pid_next;
+            return index;
+        }
+    }
+    return -1;
+}
+
+// Only notes the exit; the shell reaps in reap_exits(), outside signal context
 void sigchld_handler(int sig_num) {
-    int status;
+    child_exited = 1;
+}
+
+// Exited jobs are found through their readable pidfds, so each exit costs
+// O(1) and a pid reused by another process is never mistaken for the job.
+// Jobs without a pidfd are reaped after SIGCHLD and looked up by pid.
+void reap_exits() {
+    struct epoll_event events[16];
+    int n;
+    while ((n = epoll_wait(exit_epoll_fd, events, 16, 0)) > 0) {
+        for (int i = 0; i < n; i++) {
+            command_info *job = &command_history[events[i].data.u32];
+            waitpid(job->pid, NULL, 0); // already a zombie, returns at once
+            record_exit(job);
+        }
+    }
+    if (!child_exited) return;
+    child_exited = 0;
     pid_t pid;
-    struct timeval end_time;
+    while (unwatched_jobs > 0 && (pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+        int index = unwatched_take(pid);
+        if (index >= 0) record_exit(&command_history[index]);
+    }
+}
 
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        for (int i = 0; i < history_count; i++) {
-            if (command_history[i].pid == pid && !command_history[i].completed) {
-                gettimeofday(&end_time, NULL);
-                command_history[i].duration = (end_time.tv_sec - command_history[i].start_time.tv_sec) * 1000 +
-                                              (end_time.tv_usec - command_history[i].start_time.tv_usec) / 1000;
-                command_history[i].completed = true;
-                break;
-            }
+// Waits until stdin has input, recording job exits while it waits. SIGCHLD
+// is blocked everywhere else, so one arriving just before ppoll() still wakes it.
+void wait_for_input(const sigset_t *wait_mask) {
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {exit_epoll_fd, POLLIN, 0}};
+    for (;;) {
+        int n = ppoll(fds, 2, NULL, wait_mask);
+        if (n == -1 && errno != EINTR) {
+            perror("ppoll");
+            return;
         }
+        reap_exits();
+        if (n > 0 && fds[0].revents != 0) return;
+    }
+}
+
+// Makes room for one more history entry
+void grow_history() {
+    if (history_count < history_capacity) return;
+    history_capacity = history_capacity == 0 ? INITIAL_JOBS : history_capacity * 2;
+    command_history = realloc(command_history, history_capacity * sizeof(command_info));
+    if (command_history == NULL) {
+        perror("History allocation failed");
+        exit(1);
     }
 }
 
-void execute_command(char* command, bool is_bg_cmd) {
+// Forks the job and passes it to the scheduler process without waking it
+pid_t launch_job(char* command, int priority, int shares, long arrival_us) {
+    grow_history();
+    // SIGCONT stays blocked in the child until it waits for it, so the
+    // scheduler's first SIGCONT is kept pending however early it comes
+    sigset_t start_signal, old_mask;
+    sigemptyset(&start_signal);
+    sigaddset(&start_signal, SIGCONT);
+    sigprocmask(SIG_BLOCK, &start_signal, &old_mask);
     int id = fork();
 
     if (id < 0) {
@@ -92,7 +230,16 @@ void execute_command(char* command, bool is_bg_cmd) {
     }
     else if (id == 0) {
         // Child process (Job)
-        pause();  // Wait for SIGCONT as per dummy_main.h's logic
+        setpgid(0, 0);  // The job and everything it starts form one group
+        // Background groups that read the terminal are stopped, so jobs get no input
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd != -1) {
+            dup2(null_fd, STDIN_FILENO);
+            close(null_fd);
+        }
+        while (sigwaitinfo(&start_signal, NULL) == -1) {}  // Wait for the first dispatch
+        sigdelset(&old_mask, SIGCHLD);  // the shell blocks it outside ppoll(), the job should not
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
         
         // Execute the command
         char *args[BUFFER_SIZE];
@@ -110,45 +257,321 @@ void execute_command(char* command, bool is_bg_cmd) {
         }
     } else {
         // Parent process (Shell)
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
         command_history[history_count].pid = id;
         command_history[history_count].command = strdup(command);
         gettimeofday(&command_history[history_count].start_time, NULL);
         command_history[history_count].duration = -1;
         command_history[history_count].completed = false;
+        command_history[history_count].pid_fd = watched_jobs < MAX_PIDFDS ? open_pidfd(id) : -1;
+        if (command_history[history_count].pid_fd >= 0) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u32 = history_count;
+            epoll_ctl(exit_epoll_fd, EPOLL_CTL_ADD, command_history[history_count].pid_fd, &ev);
+            watched_jobs++;
+        }
+        else {
+            unwatched_add(history_count);
+            unwatched_jobs++;
+        }
         
-        kill(id, SIGSTOP);  // Immediately stop the new process
-        enqueue(id);         // Add the process to the ready queue
+        setpgid(id, id);  // Also here, so the group exists before the first killpg
+
+        // Hand the job to the scheduler process
+        job_record job;
+        job.pid = id;
+        job.priority = priority;
+        job.shares = shares;
+        job.arrival_us = arrival_us;
+        clock_gettime(CLOCK_MONOTONIC, &job.submit_time);
+        while (!job_ring_push(submit_ring, &job)) {
+            job_ring_notify(submit_ring);  // ring full, let the scheduler catch up
+            usleep(100);
+        }
         history_count++;
+    }
+    return id;
+}
 
-        if (!is_bg_cmd) {
-            printf("Submitted process (PID: %d) is now in ready queue\n", id);
+void execute_command(char* command, int priority, int shares, bool is_bg_cmd) {
+    pid_t id = launch_job(command, priority, shares, 0);
+    job_ring_notify(submit_ring);
+    if (!is_bg_cmd) {
+        printf("Submitted process (PID: %d) is now in ready queue\n", id);
+    }
+}
+
+// Launches every job in a manifest, then wakes the scheduler once for all of them
+void submit_batch(const char *path) {
+    FILE *manifest = fopen(path, "r");
+    if (manifest == NULL) {
+        perror(path);
+        return;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long start_us = start.tv_sec * 1000000L + start.tv_nsec / 1000;
+    char *line = NULL;
+    size_t size = 0;
+    int count = 0, line_number = 0;
+    while (getline(&line, &size, manifest) != -1) {
+        line_number++;
+        double arrival_ms;
+        int priority, shares;
+        char *command;
+        int parsed = policy_parse_batch_line(line, &arrival_ms, &priority, &shares, &command);
+        if (parsed == 0) continue;
+        if (parsed < 0) {
+            fprintf(stderr, "%s:%d: expected <arrival_ms> <priority> [--shares N] <command>\n", path, line_number);
+            continue;
         }
+        // Offsets count from the start of the batch, not from each job's launch
+        launch_job(command, priority, shares, arrival_ms > 0 ? start_us + (long)(arrival_ms * 1000) : 0);
+        count++;
     }
+    free(line);
+    fclose(manifest);
+    job_ring_notify(submit_ring);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed_us = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    printf("Submitted %d jobs from %s in %.3f ms (%.1f us per job)\n", count, path, elapsed_us / 1000.0,
+           count > 0 ? elapsed_us / count : 0.0);
 }
 
-void simple_scheduler() {
-    struct timespec ts;
-    ts.tv_sec = TSLICE / 1000;
-    ts.tv_nsec = (TSLICE % 1000) * 1000000;
-
-    while (1) {
-        for (int i = 0; i < NCPU && rq_size > 0; i++) {
-            int pid = dequeue();
-            if (pid > 0) {
-                kill(pid, SIGCONT);  // Resume execution
+void scheduler_term_handler(int sig_num) {
+    scheduler_stop = 1;
+}
+
+// CPU time the process has used so far, -1 once it is gone
+long process_cpu_us(pid_t pid) {
+    clockid_t clock;
+    struct timespec used;
+    if (clock_getcpuclockid(pid, &clock) != 0 || clock_gettime(clock, &used) == -1) return -1;
+    return used.tv_sec * 1000000L + used.tv_nsec / 1000;
+}
+
+// Fills idle CPU slots with the jobs the policy picks, resuming only stopped ones
+void dispatch_free_slots() {
+    for (int s = 0; s < NCPU; s++) {
+        while (running_jobs[s] == NULL) {
+            sched_job *next = policy->ops->pick_next(policy);
+            if (next == NULL) return;
+            scheduled_job *job = sched_jobs[next->id];
+            if (job->exited) continue; // exited while queued
+            if (!job->on_cpu) {
+                if (killpg(job->pid, SIGCONT) == -1) continue; // reaped by the shell
+                job->on_cpu = true;
             }
+            job->slot = s;
+            running_jobs[s] = job;
         }
+    }
+}
 
-        nanosleep(&ts, NULL);  // Wait for TSLICE duration
+// Charges the slice that just ended and stops jobs whose quantum ran out
+void end_of_slice(long now_us) {
+    scheduled_job *preempted[NCPU];
+    int npreempted = 0;
+
+    for (int s = 0; s < NCPU; s++) {
+        scheduled_job *job = running_jobs[s];
+        if (job == NULL) continue;
+        if (job->pid_fd < 0 && kill(job->pid, 0) == -1 && errno == ESRCH) {
+            job->slot = -1;
+            running_jobs[s] = NULL; // reaped by the shell
+            continue;
+        }
+        job->sj.slice_used_us += TSLICE * 1000L;
+        if (measure_runtime) {
+            long used_us = process_cpu_us(job->pid);
+            if (used_us >= 0) job->sj.runtime_us = used_us;
+        }
+        bool expired = job->sj.slice_used_us >= policy->ops->quantum_us(policy, &job->sj);
+        if (expired) {
+            policy->ops->expired(policy, &job->sj);
+            job->sj.slice_used_us = 0;
+        }
+        if ((expired && policy->nr_queued > 0) || policy->ops->preempts(policy, &job->sj)) {
+            policy->ops->enqueue(policy, &job->sj);
+            job->slot = -1;
+            running_jobs[s] = NULL;
+            preempted[npreempted++] = job;
+        }
+    }
+    policy->ops->tick(policy, now_us);
+    dispatch_free_slots();
+
+    // Jobs picked again keep running; only the ones that lost their slot are stopped
+    for (int i = 0; i < npreempted; i++) {
+        if (preempted[i]->slot == -1) {
+            killpg(preempted[i]->pid, SIGSTOP);
+            preempted[i]->on_cpu = false;
+        }
+    }
+}
+
+int compare_arrivals(const void *a, const void *b) {
+    long x = ((const pending_arrival *)a)->arrival_us, y = ((const pending_arrival *)b)->arrival_us;
+    return (x > y) - (x < y);
+}
+
+void add_arrival(scheduled_job *job, long arrival_us) {
+    if (narrivals == arrivals_capacity) {
+        arrivals_capacity = arrivals_capacity == 0 ? INITIAL_JOBS : arrivals_capacity * 2;
+        arrivals = realloc(arrivals, arrivals_capacity * sizeof(pending_arrival));
+        if (arrivals == NULL) {
+            perror("Scheduler: arrival list allocation failed");
+            exit(1);
+        }
+    }
+    arrivals[narrivals].job = job;
+    arrivals[narrivals++].arrival_us = arrival_us;
+}
+
+// Enqueues the batch jobs whose arrival time has passed; checked every slice
+void release_arrivals() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long now_us = now.tv_sec * 1000000L + now.tv_nsec / 1000;
+    while (next_arrival < narrivals && arrivals[next_arrival].arrival_us <= now_us) {
+        scheduled_job *job = arrivals[next_arrival++].job;
+        if (!job->exited) policy->ops->enqueue(policy, &job->sj);
+    }
+    if (next_arrival == narrivals) next_arrival = narrivals = 0;
+}
 
-        for (int i = 0; i < NCPU && rq_size > 0; i++) {
-            int pid = dequeue();
-            if (pid > 0) {
-                kill(pid, SIGSTOP);  // Pause the process after TSLICE
-                enqueue(pid);        // Re-enqueue it for the next round
+// Moves every submission out of the shared ring and starts it if a slot is free
+void drain_submissions() {
+    job_record job;
+    struct timespec now;
+
+    job_ring_clear_notify(submit_ring);
+    int delayed = 0;
+    while (job_ring_pop(submit_ring, &job)) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long latency = (now.tv_sec - job.submit_time.tv_sec) * 1000000000L + (now.tv_nsec - job.submit_time.tv_nsec);
+        submit_count++;
+        submit_latency_sum_ns += latency;
+        if (latency > submit_latency_max_ns) submit_latency_max_ns = latency;
+        if (sched_job_count == sched_job_capacity) {
+            sched_job_capacity = sched_job_capacity == 0 ? INITIAL_JOBS : sched_job_capacity * 2;
+            sched_jobs = realloc(sched_jobs, sched_job_capacity * sizeof(scheduled_job *));
+            if (sched_jobs == NULL) {
+                perror("Scheduler: job table allocation failed");
+                exit(1);
             }
         }
+        scheduled_job *entry = malloc(sizeof(scheduled_job));
+        if (entry == NULL) {
+            perror("Scheduler: job allocation failed");
+            exit(1);
+        }
+        entry->pid = job.pid;
+        entry->slot = -1;
+        entry->on_cpu = false;
+        entry->exited = false;
+        // The job waits for its first SIGCONT, so it is still alive and the pid still refers to it
+        entry->pid_fd = scheduler_pidfds < MAX_PIDFDS ? open_pidfd(job.pid) : -1;
+        if (entry->pid_fd >= 0) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u32 = EV_JOB_EXIT + sched_job_count;
+            epoll_ctl(scheduler_epoll_fd, EPOLL_CTL_ADD, entry->pid_fd, &ev);
+            scheduler_pidfds++;
+        }
+        sched_job_init(&entry->sj, sched_job_count, job.priority);
+        entry->sj.tickets = job.shares;
+        sched_jobs[sched_job_count++] = entry;
+        if (job.arrival_us > 0) {
+            add_arrival(entry, job.arrival_us);
+            delayed++;
+        }
+        else {
+            policy->ops->enqueue(policy, &entry->sj);
+        }
     }
+    if (delayed > 0) {
+        qsort(arrivals + next_arrival, narrivals - next_arrival, sizeof(pending_arrival), compare_arrivals);
+    }
+    dispatch_free_slots();
+}
+
+// The job's pidfd became readable: free its slot at once instead of at the end of the slice
+void job_exited(scheduled_job *job) {
+    epoll_ctl(scheduler_epoll_fd, EPOLL_CTL_DEL, job->pid_fd, NULL);
+    close(job->pid_fd);
+    job->pid_fd = -1;
+    scheduler_pidfds--;
+    job->exited = true;
+    if (job->slot >= 0) {
+        running_jobs[job->slot] = NULL;
+        job->slot = -1;
+        dispatch_free_slots();
+    }
+}
+
+void add_scheduler_event(int fd, uint32_t source) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = source;
+    if (epoll_ctl(scheduler_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        perror("Scheduler: epoll_ctl");
+        exit(1);
+    }
+}
+
+void simple_scheduler() {
+    signal(SIGINT, SIG_IGN);  // the shell handles Ctrl+C and then terminates us
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGTERM, scheduler_term_handler);
+
+    running_jobs = calloc(NCPU, sizeof(scheduled_job *));
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = TSLICE / 1000;
+    spec.it_interval.tv_nsec = (TSLICE % 1000) * 1000000;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+
+    // Sleep until a submission arrives, a job exits or the slice ends
+    scheduler_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (scheduler_epoll_fd == -1) {
+        perror("Scheduler: epoll_create1");
+        exit(1);
+    }
+    add_scheduler_event(submit_ring->event_fd, EV_SUBMIT);
+    add_scheduler_event(timer_fd, EV_TICK);
+
+    long slices = 0;
+    while (!scheduler_stop) {
+        struct epoll_event events[16];
+        int n = epoll_wait(scheduler_epoll_fd, events, 16, -1);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u32 == EV_SUBMIT) {
+                drain_submissions();
+            }
+            else if (events[i].data.u32 == EV_TICK) {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                    slices += expirations;
+                }
+                if (narrivals > 0) release_arrivals();
+                end_of_slice(slices * TSLICE * 1000L);
+            }
+            else {
+                scheduled_job *job = sched_jobs[events[i].data.u32 - EV_JOB_EXIT];
+                if (job->pid_fd >= 0) job_exited(job);
+            }
+        }
+    }
+
+    if (submit_count > 0) {
+        printf("Scheduler: %ld submissions, latency mean %.1f us, max %.1f us\n", submit_count,
+               submit_latency_sum_ns / 1000.0 / submit_count, submit_latency_max_ns / 1000.0);
+    }
+    policy_destroy(policy);
+    exit(0);
 }
 
 void start_scheduler() {
@@ -172,28 +595,72 @@ bool check_if_bg(char *command) {
     return false;
 }
 
+void usage(char *program) {
+    fprintf(stderr, "Usage: %s <NCPU> <TSLICE(ms)> [options]\n", program);
+    policy_usage(stderr);
+    fprintf(stderr, "  --batch file           run a submit-batch manifest instead of reading commands\n");
+    exit(1);
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <NCPU> <TSLICE(ms)>\n", argv[0]);
-        exit(1);
+    static struct option long_options[] = {
+        POLICY_LONG_OPTIONS,
+        {"batch", required_argument, NULL, OPT_BATCH},
+        {NULL, 0, NULL, 0},
+    };
+    policy_config config;
+    policy_config_init(&config);
+    const char *batch_path = NULL;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        if (opt == OPT_BATCH) {
+            batch_path = optarg;
+        }
+        else if (opt == '?' || !policy_config_option(&config, opt, optarg)) {
+            usage(argv[0]);
+        }
     }
+    if (argc - optind != 2) usage(argv[0]);
 
-    NCPU = atoi(argv[1]);
-    TSLICE = atoi(argv[2]);
+    NCPU = atoi(argv[optind]);
+    TSLICE = atoi(argv[optind + 1]);
 
     if (NCPU <= 0 || TSLICE <= 0) {
         fprintf(stderr, "Error: NCPU and TSLICE must be positive integers\n");
         exit(1);
     }
+    policy = policy_create(&config, TSLICE * 1000L);
+    if (policy == NULL) {
+        fprintf(stderr, "Error: unknown policy %s\n", config.name);
+        usage(argv[0]);
+    }
+    measure_runtime = strcmp(policy->ops->name, "fair") == 0;
 
     // Set up signal handlers
     signal(SIGINT, sigint_handler);
     signal(SIGCHLD, sigchld_handler); // Add the SIGCHLD handler here
 
+    submit_ring = job_ring_create();  // must exist before the fork so both sides share it
     start_scheduler();
-
-    while (1) {
+    exit_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (exit_epoll_fd == -1) {
+        perror("epoll_create1");
+        exit(1);
+    }
+    memset(pid_buckets, -1, sizeof(pid_buckets));
+    // SIGCHLD is only let through while the shell waits in ppoll()
+    sigset_t chld_signal, wait_mask;
+    sigemptyset(&chld_signal);
+    sigaddset(&chld_signal, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld_signal, &wait_mask);
+    setvbuf(stdin, NULL, _IONBF, 0);  // a line held in a stdio buffer would be invisible to ppoll()
+
+    // A --batch run is non-interactive and goes straight to waiting for its jobs
+    if (batch_path != NULL) submit_batch(batch_path);
+    while (batch_path == NULL) {
         printf("SimpleShell$ ");
+        fflush(stdout);
+        wait_for_input(&wait_mask);
 
         char user_input[BUFFER_SIZE];
         if (fgets(user_input, BUFFER_SIZE, stdin) == NULL) {
@@ -202,10 +669,19 @@ int main(int argc, char* argv[]) {
 
         user_input[strcspn(user_input, "\n")] = 0;
 
-        if (strncmp(user_input, "submit", 6) == 0) {
+        if (strncmp(user_input, "submit-batch ", 13) == 0) {
+            submit_batch(user_input + 13);
+        }
+        else if (strncmp(user_input, "submit", 6) == 0) {
             char *command = user_input + 7;
             bool is_bg_cmd = check_if_bg(command);
-            execute_command(command, is_bg_cmd);
+            int shares = policy_parse_shares(&command);
+            if (shares < 0) {
+                printf("Error: --shares needs a number from 1 to %d\n", MAX_SHARES);
+                continue;
+            }
+            int priority = policy_parse_priority(command);
+            execute_command(command, priority, shares, is_bg_cmd);
         }
         else if (strcmp(user_input, "history") == 0) {
             for (int i = 0; i < history_count; i++) {
@@ -214,6 +690,15 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // End of input: let the scheduler finish the submitted jobs before stopping it
+    for (int i = 0; i < history_count; i++) {
+        if (!command_history[i].completed) {
+            waitpid(command_history[i].pid, NULL, 0);  // ECHILD if reap_exits() got it first
+        }
+    }
+    kill(scheduler_pid, SIGTERM);
+    waitpid(scheduler_pid, NULL, 0);
+
     for (int i = 0; i < history_count; i++) {
         free(command_history[i].command);
     }
@@ -0,0 +1,30 @@
+#ifndef PIDFD_H
+#define PIDFD_H
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+/*
+ * A pidfd refers to one process rather than to a pid number, so it cannot
+ * be confused with a later process that reuses the pid. It becomes readable
+ * when the process exits, which lets an event loop wait for job exits with
+ * epoll or poll instead of scanning after SIGCHLD.
+ */
+
+// Jobs watched through a pidfd at once; exits got several times slower with
+// thousands of pidfds open, so further jobs use the SIGCHLD fallback
+#define MAX_PIDFDS 512
+
+// Returns -1 with errno set when the kernel lacks pidfds (before 5.3) or no fd is free
+static inline int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+#endif
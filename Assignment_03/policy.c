@@ -0,0 +1,691 @@
+#include <stdlib.h>
+#include <string.h>
+#include "policy.h"
+
+#define DEFAULT_MLFQ_LEVELS 3
+#define DEFAULT_BOOST_US 1000000 // 1 s
+#define DEFAULT_AGING_SLICES 8   // per level, so a job on level l waits at most 8 * l slices to move up
+#define STRIDE1 (1L << 30)       // pass added per quantum for a job with one ticket
+#define DEFAULT_LATENCY_SLICES 4 // fair: latency target in slices
+
+void sched_job_init(sched_job *job, int id, int priority) {
+    memset(job, 0, sizeof(*job));
+    job->id = id;
+    job->priority = priority;
+    job->level = -1;
+    job->tickets = DEFAULT_SHARES;
+}
+
+int policy_parse_priority(char *command) {
+    int length = strlen(command);
+    while (length > 0 && command[length - 1] == ' ') command[--length] = '\0';
+    char *last = strrchr(command, ' ');
+    if (last == NULL || last[2] != '\0' || last[1] < '0' + MIN_PRIORITY || last[1] > '0' + MAX_PRIORITY) {
+        return MIN_PRIORITY;
+    }
+    int priority = last[1] - '0';
+    *last = '\0';
+    return priority;
+}
+
+int policy_parse_shares(char **command) {
+    if (strncmp(*command, "--shares ", 9) != 0) return DEFAULT_SHARES;
+    char *end;
+    long shares = strtol(*command + 9, &end, 10);
+    if (end == *command + 9 || *end != ' ' || shares < 1 || shares > MAX_SHARES) return -1;
+    while (*end == ' ') end++;
+    *command = end;
+    return shares;
+}
+
+int policy_parse_batch_line(char *line, double *arrival_ms, int *priority, int *shares, char **command) {
+    line[strcspn(line, "#\n")] = '\0';
+    if (strspn(line, " \t") == strlen(line)) return 0;
+    int consumed = 0;
+    sscanf(line, " %lf %d %n", arrival_ms, priority, &consumed);
+    if (consumed == 0 || *arrival_ms < 0 || *priority < MIN_PRIORITY || *priority > MAX_PRIORITY) return -1;
+    *command = line + consumed;
+    *shares = policy_parse_shares(command);
+    return *shares > 0 && **command != '\0' ? 1 : -1;
+}
+
+static void queue_push(job_queue *queue, sched_job *job) {
+    job->next = NULL;
+    job->prev = queue->tail;
+    if (queue->tail != NULL) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
+    queue->count++;
+}
+
+static void queue_remove(job_queue *queue, sched_job *job) {
+    if (job->prev != NULL) {
+        job->prev->next = job->next;
+    } else {
+        queue->head = job->next;
+    }
+    if (job->next != NULL) {
+        job->next->prev = job->prev;
+    } else {
+        queue->tail = job->prev;
+    }
+    job->next = job->prev = NULL;
+    queue->count--;
+}
+
+static sched_job *queue_pop(job_queue *queue) {
+    sched_job *job = queue->head;
+    if (job != NULL) queue_remove(queue, job);
+    return job;
+}
+
+static sched_job *queue_front(job_queue *queue) {
+    return queue->head;
+}
+
+/*
+ * Multi-level run queue shared by every policy. ready_mask has bit l set
+ * while level l has jobs, so finding the best non-empty level is a single
+ * count-trailing-zeros instead of a scan over the levels.
+ */
+
+static void runqueue_push(sched_policy *policy, sched_job *job) {
+    job->enqueued_us = policy->now_us;
+    queue_push(&policy->queues[job->level], job);
+    policy->ready_mask |= 1u << job->level;
+    policy->nr_queued++;
+}
+
+static sched_job *runqueue_pop(sched_policy *policy, int level) {
+    sched_job *job = queue_pop(&policy->queues[level]);
+    if (policy->queues[level].count == 0) {
+        policy->ready_mask &= ~(1u << level);
+    }
+    policy->nr_queued--;
+    return job;
+}
+
+// Best non-empty level, or -1 when every queue is empty
+static int runqueue_best_level(sched_policy *policy) {
+    return policy->ready_mask == 0 ? -1 : __builtin_ctz(policy->ready_mask);
+}
+
+static sched_job *runqueue_pick_next(sched_policy *policy) {
+    int level = runqueue_best_level(policy);
+    return level < 0 ? NULL : runqueue_pop(policy, level);
+}
+
+/*
+ * Multi-level feedback queue. New jobs start at level 0; a job that uses its
+ * whole quantum drops one level and gets the longer quantum of that level.
+ * Every boost_us all jobs go back to level 0 so CPU hogs that sank to the
+ * bottom cannot starve. Round robin is the same code with a single level.
+ */
+
+// A boost since the job's level was set sends it back to the top
+static void mlfq_apply_boost(sched_policy *policy, sched_job *job) {
+    if (job->level < 0 || job->boost_epoch != policy->boost_epoch) {
+        job->boost_epoch = policy->boost_epoch;
+        job->level = 0;
+    }
+}
+
+static void mlfq_enqueue(sched_policy *policy, sched_job *job) {
+    mlfq_apply_boost(policy, job);
+    runqueue_push(policy, job);
+}
+
+static long mlfq_quantum_us(sched_policy *policy, sched_job *job) {
+    mlfq_apply_boost(policy, job);
+    return policy->quanta_us[job->level];
+}
+
+static void mlfq_expired(sched_policy *policy, sched_job *job) {
+    if (job->level < policy->levels - 1) {
+        job->level++;
+    }
+}
+
+// A queued job on a higher level takes the slot of a job on a lower one
+static bool mlfq_preempts(sched_policy *policy, sched_job *running) {
+    mlfq_apply_boost(policy, running);
+    int best = runqueue_best_level(policy);
+    return best >= 0 && best < running->level;
+}
+
+static void mlfq_tick(sched_policy *policy, long now_us) {
+    policy->now_us = now_us;
+    if (policy->boost_us <= 0 || now_us - policy->last_boost_us < policy->boost_us) return;
+    policy->last_boost_us = now_us;
+    policy->boost_epoch++;
+    // Queued jobs move now; running jobs pick the boost up through their epoch
+    for (int level = 1; level < policy->levels; level++) {
+        while (policy->queues[level].count > 0) {
+            sched_job *job = runqueue_pop(policy, level);
+            job->level = 0;
+            job->boost_epoch = policy->boost_epoch;
+            runqueue_push(policy, job);
+        }
+    }
+}
+
+// Destroy op of the policies that keep their run queues inside the jobs
+static void policy_free(sched_policy *policy) {
+    free(policy);
+}
+
+static const sched_policy_ops rr_ops = {
+    "rr", mlfq_enqueue, runqueue_pick_next, mlfq_quantum_us, mlfq_expired, mlfq_preempts, mlfq_tick,
+    policy_free,
+};
+
+static const sched_policy_ops mlfq_ops = {
+    "mlfq", mlfq_enqueue, runqueue_pick_next, mlfq_quantum_us, mlfq_expired, mlfq_preempts, mlfq_tick,
+    policy_free,
+};
+
+/*
+ * Static priorities with aging. Each submit priority has its own level
+ * (MAX_PRIORITY on level 0) and a higher level preempts a lower one at the
+ * next tick, so a high-priority job gets a CPU within one slice. A job that
+ * has waited aging_us[l] on level l moves up one level; once it has used a
+ * full quantum it drops back to the level of its own priority.
+ */
+
+static int prio_base_level(sched_job *job) {
+    return MAX_PRIORITY - job->priority;
+}
+
+static void prio_enqueue(sched_policy *policy, sched_job *job) {
+    if (job->level < 0) {
+        job->level = prio_base_level(job);
+    }
+    runqueue_push(policy, job);
+}
+
+static long prio_quantum_us(sched_policy *policy, sched_job *job) {
+    return policy->quanta_us[prio_base_level(job)];
+}
+
+static void prio_expired(sched_policy *policy, sched_job *job) {
+    job->level = prio_base_level(job);
+}
+
+static bool prio_preempts(sched_policy *policy, sched_job *running) {
+    int best = runqueue_best_level(policy);
+    return best >= 0 && best < running->level;
+}
+
+// Queues are FIFO, so only the fronts need checking against the aging limit
+static void prio_tick(sched_policy *policy, long now_us) {
+    policy->now_us = now_us;
+    for (int level = 1; level < policy->levels; level++) {
+        sched_job *job;
+        while ((job = queue_front(&policy->queues[level])) != NULL &&
+               now_us - job->enqueued_us >= policy->aging_us[level]) {
+            runqueue_pop(policy, level);
+            job->level = level - 1;
+            runqueue_push(policy, job);
+        }
+    }
+}
+
+static const sched_policy_ops prio_ops = {
+    "prio", prio_enqueue, runqueue_pick_next, prio_quantum_us, prio_expired, prio_preempts, prio_tick,
+    policy_free,
+};
+
+/*
+ * Stride scheduling. Every job has a pass value that grows by
+ * STRIDE1 / tickets for each quantum it uses, and the queued job with the
+ * lowest pass runs next, so over time each job gets CPU in proportion to
+ * its tickets. Queued jobs sit in a binary min-heap on pass. A job joining
+ * the queue starts no lower than the pass of the last job picked, so new,
+ * woken or migrated jobs cannot catch up on time they were not runnable.
+ */
+
+static bool stride_before(sched_job *a, sched_job *b) {
+    return a->pass < b->pass || (a->pass == b->pass && a->id < b->id);
+}
+
+static void heap_swap(sched_job **heap, int i, int j) {
+    sched_job *job = heap[i];
+    heap[i] = heap[j];
+    heap[j] = job;
+}
+
+static void stride_enqueue(sched_policy *policy, sched_job *job) {
+    if (policy->nr_queued == policy->heap_capacity) {
+        policy->heap_capacity = policy->heap_capacity == 0 ? 64 : policy->heap_capacity * 2;
+        policy->heap = realloc(policy->heap, policy->heap_capacity * sizeof(sched_job *));
+        if (policy->heap == NULL) {
+            perror("Run queue allocation failed");
+            exit(1);
+        }
+    }
+    if (job->pass < policy->pass_floor) job->pass = policy->pass_floor;
+    job->enqueued_us = policy->now_us;
+    int i = policy->nr_queued++;
+    policy->heap[i] = job;
+    while (i > 0 && stride_before(policy->heap[i], policy->heap[(i - 1) / 2])) {
+        heap_swap(policy->heap, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static sched_job *stride_pick_next(sched_policy *policy) {
+    if (policy->nr_queued == 0) return NULL;
+    sched_job **heap = policy->heap;
+    sched_job *job = heap[0];
+    int n = --policy->nr_queued;
+    heap[0] = heap[n];
+    for (int i = 0;;) {
+        int smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < n && stride_before(heap[left], heap[smallest])) smallest = left;
+        if (right < n && stride_before(heap[right], heap[smallest])) smallest = right;
+        if (smallest == i) break;
+        heap_swap(heap, i, smallest);
+        i = smallest;
+    }
+    policy->pass_floor = job->pass;
+    return job;
+}
+
+static long stride_quantum_us(sched_policy *policy, sched_job *job) {
+    return policy->quanta_us[0];
+}
+
+static void stride_expired(sched_policy *policy, sched_job *job) {
+    job->pass += STRIDE1 / job->tickets;
+}
+
+// Jobs run out their quantum; the pass order decides at the next expiry
+static bool stride_preempts(sched_policy *policy, sched_job *running) {
+    return false;
+}
+
+static void stride_tick(sched_policy *policy, long now_us) {
+    policy->now_us = now_us;
+}
+
+static void stride_destroy(sched_policy *policy) {
+    free(policy->heap);
+    free(policy);
+}
+
+static const sched_policy_ops stride_ops = {
+    "stride", stride_enqueue, stride_pick_next, stride_quantum_us, stride_expired, stride_preempts, stride_tick,
+    stride_destroy,
+};
+
+/*
+ * Fair scheduling on virtual runtime, after Linux CFS. The caller keeps
+ * runtime_us at the CPU time the job has actually used; the policy folds
+ * each increase into vruntime scaled by NICE0_WEIGHT / weight, where every
+ * priority step doubles the weight. Queued jobs sit in a red-black tree
+ * ordered by vruntime with the leftmost node cached, and the leftmost job
+ * runs next. A job's quantum is its weighted share of the latency target,
+ * but never less than the minimum granularity.
+ */
+
+#define NICE0_WEIGHT 1024
+
+static long fair_weight(sched_job *job) {
+    return (long)NICE0_WEIGHT << (job->priority - MIN_PRIORITY);
+}
+
+static bool fair_before(sched_job *a, sched_job *b) {
+    return a->vruntime < b->vruntime || (a->vruntime == b->vruntime && a->id < b->id);
+}
+
+// Charges CPU time used since the last call to the job's vruntime
+static void fair_update(sched_job *job) {
+    long delta = job->runtime_us - job->charged_us;
+    if (delta <= 0) return;
+    job->charged_us = job->runtime_us;
+    job->vruntime += delta * NICE0_WEIGHT / fair_weight(job);
+}
+
+// Points whatever referred to old at new instead
+static void rb_replace_child(sched_policy *policy, sched_job *parent, sched_job *old, sched_job *new) {
+    if (parent == NULL) {
+        policy->rb_root = new;
+    } else if (parent->rb_left == old) {
+        parent->rb_left = new;
+    } else {
+        parent->rb_right = new;
+    }
+}
+
+static void rb_rotate_left(sched_policy *policy, sched_job *x) {
+    sched_job *y = x->rb_right;
+    x->rb_right = y->rb_left;
+    if (y->rb_left) y->rb_left->rb_parent = x;
+    y->rb_parent = x->rb_parent;
+    rb_replace_child(policy, x->rb_parent, x, y);
+    y->rb_left = x;
+    x->rb_parent = y;
+}
+
+static void rb_rotate_right(sched_policy *policy, sched_job *x) {
+    sched_job *y = x->rb_left;
+    x->rb_left = y->rb_right;
+    if (y->rb_right) y->rb_right->rb_parent = x;
+    y->rb_parent = x->rb_parent;
+    rb_replace_child(policy, x->rb_parent, x, y);
+    y->rb_right = x;
+    x->rb_parent = y;
+}
+
+static bool rb_is_red(sched_job *job) {
+    return job != NULL && job->rb_red;
+}
+
+static void rb_insert(sched_policy *policy, sched_job *job) {
+    sched_job *parent = NULL, **link = &policy->rb_root;
+    bool leftmost = true;
+    while (*link) {
+        parent = *link;
+        if (fair_before(job, parent)) {
+            link = &parent->rb_left;
+        } else {
+            link = &parent->rb_right;
+            leftmost = false;
+        }
+    }
+    job->rb_parent = parent;
+    job->rb_left = job->rb_right = NULL;
+    job->rb_red = true;
+    *link = job;
+    if (leftmost) policy->rb_leftmost = job;
+
+    while (rb_is_red(job->rb_parent)) {
+        parent = job->rb_parent;
+        sched_job *grandparent = parent->rb_parent; // a red node is never the root
+        bool left = parent == grandparent->rb_left;
+        sched_job *uncle = left ? grandparent->rb_right : grandparent->rb_left;
+        if (rb_is_red(uncle)) {
+            parent->rb_red = uncle->rb_red = false;
+            grandparent->rb_red = true;
+            job = grandparent;
+            continue;
+        }
+        if (job == (left ? parent->rb_right : parent->rb_left)) {
+            if (left) rb_rotate_left(policy, parent);
+            else rb_rotate_right(policy, parent);
+            job = parent;
+            parent = job->rb_parent;
+        }
+        parent->rb_red = false;
+        grandparent->rb_red = true;
+        if (left) rb_rotate_right(policy, grandparent);
+        else rb_rotate_left(policy, grandparent);
+    }
+    policy->rb_root->rb_red = false;
+}
+
+// Removes the cached leftmost job, the only one the policy ever takes out
+static void rb_erase_leftmost(sched_policy *policy) {
+    sched_job *job = policy->rb_leftmost;
+    sched_job *child = job->rb_right, *parent = job->rb_parent;
+    rb_replace_child(policy, parent, job, child);
+    if (child) {
+        child->rb_parent = parent;
+        sched_job *next = child;
+        while (next->rb_left) next = next->rb_left;
+        policy->rb_leftmost = next;
+    } else {
+        policy->rb_leftmost = parent;
+    }
+    if (job->rb_red) return;
+
+    // The removed black node leaves child one black short; push the deficit up
+    while (child != policy->rb_root && !rb_is_red(child)) {
+        bool left = child == parent->rb_left;
+        sched_job *sibling = left ? parent->rb_right : parent->rb_left;
+        if (sibling->rb_red) {
+            sibling->rb_red = false;
+            parent->rb_red = true;
+            if (left) rb_rotate_left(policy, parent);
+            else rb_rotate_right(policy, parent);
+            sibling = left ? parent->rb_right : parent->rb_left;
+        }
+        sched_job *near = left ? sibling->rb_left : sibling->rb_right;
+        sched_job *far = left ? sibling->rb_right : sibling->rb_left;
+        if (!rb_is_red(near) && !rb_is_red(far)) {
+            sibling->rb_red = true;
+            child = parent;
+            parent = child->rb_parent;
+            continue;
+        }
+        if (!rb_is_red(far)) {
+            near->rb_red = false;
+            sibling->rb_red = true;
+            if (left) rb_rotate_right(policy, sibling);
+            else rb_rotate_left(policy, sibling);
+            far = sibling;
+            sibling = near;
+        }
+        sibling->rb_red = parent->rb_red;
+        parent->rb_red = false;
+        far->rb_red = false;
+        if (left) rb_rotate_left(policy, parent);
+        else rb_rotate_right(policy, parent);
+        child = policy->rb_root;
+    }
+    if (child) child->rb_red = false;
+}
+
+static void fair_enqueue(sched_policy *policy, sched_job *job) {
+    fair_update(job);
+    if (job->level < 0) {
+        // New jobs start level with the queue instead of owing or being owed time
+        job->level = 0;
+        job->vruntime = policy->min_vruntime;
+    } else if (job->vruntime < policy->min_vruntime - policy->latency_us / 2) {
+        // Woken or migrated jobs get at most half a latency period of credit
+        job->vruntime = policy->min_vruntime - policy->latency_us / 2;
+    }
+    job->enqueued_us = policy->now_us;
+    policy->total_weight += fair_weight(job);
+    policy->nr_queued++;
+    rb_insert(policy, job);
+}
+
+static sched_job *fair_pick_next(sched_policy *policy) {
+    sched_job *job = policy->rb_leftmost;
+    if (job == NULL) return NULL;
+    rb_erase_leftmost(policy);
+    policy->total_weight -= fair_weight(job);
+    policy->nr_queued--;
+    if (job->vruntime > policy->min_vruntime) policy->min_vruntime = job->vruntime;
+    return job;
+}
+
+static long fair_quantum_us(sched_policy *policy, sched_job *job) {
+    fair_update(job);
+    long weight = fair_weight(job);
+    long quantum = policy->latency_us * weight / (policy->total_weight + weight);
+    return quantum > policy->min_granularity_us ? quantum : policy->min_granularity_us;
+}
+
+static void fair_expired(sched_policy *policy, sched_job *job) {
+    fair_update(job);
+}
+
+// The leftmost job takes over once the running one is a granule ahead of it
+static bool fair_preempts(sched_policy *policy, sched_job *running) {
+    fair_update(running);
+    sched_job *next = policy->rb_leftmost;
+    return next != NULL && running->vruntime - next->vruntime > policy->min_granularity_us;
+}
+
+static void fair_tick(sched_policy *policy, long now_us) {
+    policy->now_us = now_us;
+}
+
+static const sched_policy_ops fair_ops = {
+    "fair", fair_enqueue, fair_pick_next, fair_quantum_us, fair_expired, fair_preempts, fair_tick,
+    policy_free,
+};
+
+void policy_config_init(policy_config *config) {
+    memset(config, 0, sizeof(*config));
+    config->name = "prio";
+    config->levels = DEFAULT_MLFQ_LEVELS;
+    config->boost_us = -1;
+}
+
+// Parses a comma separated list of per-level times in ms, e.g. 10,20,40
+static bool parse_level_list(const char *arg, long *values_us) {
+    char *end;
+    for (int level = 0; level < POLICY_MAX_LEVELS && *arg != '\0'; level++) {
+        double ms = strtod(arg, &end);
+        if (end == arg || ms <= 0) return false;
+        values_us[level] = (long)(ms * 1000 + 0.5);
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return *arg == '\0';
+}
+
+bool policy_config_option(policy_config *config, int opt, const char *arg) {
+    char *end;
+    switch (opt) {
+    case POLICY_OPT_BASE:
+        config->name = arg;
+        return true;
+    case POLICY_OPT_BASE + 1:
+        config->levels = strtol(arg, &end, 10);
+        return *end == '\0' && config->levels >= 1 && config->levels <= POLICY_MAX_LEVELS;
+    case POLICY_OPT_BASE + 2:
+        return parse_level_list(arg, config->quanta_us);
+    case POLICY_OPT_BASE + 3:
+        config->boost_us = (long)(strtod(arg, &end) * 1000 + 0.5);
+        return *end == '\0' && config->boost_us >= 0;
+    case POLICY_OPT_BASE + 4:
+        return parse_level_list(arg, config->aging_us);
+    case POLICY_OPT_BASE + 5:
+        config->latency_us = (long)(strtod(arg, &end) * 1000 + 0.5);
+        return *end == '\0' && config->latency_us > 0;
+    case POLICY_OPT_BASE + 6:
+        config->min_granularity_us = (long)(strtod(arg, &end) * 1000 + 0.5);
+        return *end == '\0' && config->min_granularity_us > 0;
+    }
+    return false;
+}
+
+void policy_usage(FILE *out) {
+    fprintf(out, "  --policy prio|rr|mlfq|stride|fair\n");
+    fprintf(out, "                         scheduling policy (default prio; equal priorities behave as rr;\n");
+    fprintf(out, "                         stride shares the CPU by submit --shares N, default %d)\n", DEFAULT_SHARES);
+    fprintf(out, "  --levels N             MLFQ levels (default %d, max %d)\n", DEFAULT_MLFQ_LEVELS, POLICY_MAX_LEVELS);
+    fprintf(out, "  --quanta q0,q1,..      quantum per level in ms (default TSLICE, doubling per level for mlfq)\n");
+    fprintf(out, "  --boost ms             MLFQ priority boost period, 0 disables (default %d)\n", DEFAULT_BOOST_US / 1000);
+    fprintf(out, "  --aging a0,a1,..       prio: max wait per level in ms before moving up (default %d slices * level)\n",
+            DEFAULT_AGING_SLICES);
+    fprintf(out, "  --latency-target ms    fair: period in which every queued job runs once (default %d slices)\n",
+            DEFAULT_LATENCY_SLICES);
+    fprintf(out, "  --min-granularity ms   fair: shortest quantum (default TSLICE)\n");
+}
+
+// Copies per-level values from the config, repeating the last one given
+static void fill_levels(long *out, const long *given, int levels, long fallback_us, int shift_per_level) {
+    for (int level = 0; level < levels; level++) {
+        if (given[level] > 0) {
+            out[level] = given[level];
+        } else if (level > 0 && given[0] > 0) {
+            out[level] = out[level - 1];
+        } else {
+            out[level] = fallback_us << (shift_per_level * level);
+        }
+    }
+}
+
+sched_policy *policy_create(const policy_config *config, long tslice_us) {
+    const sched_policy_ops *ops;
+    if (strcmp(config->name, "prio") == 0) {
+        ops = &prio_ops;
+    } else if (strcmp(config->name, "rr") == 0) {
+        ops = &rr_ops;
+    } else if (strcmp(config->name, "mlfq") == 0) {
+        ops = &mlfq_ops;
+    } else if (strcmp(config->name, "stride") == 0) {
+        ops = &stride_ops;
+    } else if (strcmp(config->name, "fair") == 0) {
+        ops = &fair_ops;
+    } else {
+        return NULL;
+    }
+
+    sched_policy *policy = calloc(1, sizeof(sched_policy));
+    policy->ops = ops;
+    policy->tslice_us = tslice_us;
+    if (ops == &rr_ops || ops == &stride_ops) {
+        policy->levels = 1;
+        policy->quanta_us[0] = tslice_us;
+    } else if (ops == &fair_ops) {
+        policy->levels = 1;
+        policy->quanta_us[0] = tslice_us;
+        policy->latency_us = config->latency_us > 0 ? config->latency_us : DEFAULT_LATENCY_SLICES * tslice_us;
+        policy->min_granularity_us = config->min_granularity_us > 0 ? config->min_granularity_us : tslice_us;
+    } else if (ops == &mlfq_ops) {
+        policy->levels = config->levels;
+        policy->boost_us = config->boost_us < 0 ? DEFAULT_BOOST_US : config->boost_us;
+        fill_levels(policy->quanta_us, config->quanta_us, policy->levels, tslice_us, 1);
+    } else {
+        policy->levels = MAX_PRIORITY - MIN_PRIORITY + 1;
+        fill_levels(policy->quanta_us, config->quanta_us, policy->levels, tslice_us, 0);
+        if (config->aging_us[0] > 0) {
+            fill_levels(policy->aging_us, config->aging_us, policy->levels, 0, 0);
+        } else {
+            for (int level = 0; level < policy->levels; level++) {
+                policy->aging_us[level] = DEFAULT_AGING_SLICES * tslice_us * level;
+            }
+        }
+    }
+    return policy;
+}
+
+void policy_set_tslice(sched_policy *policy, long tslice_us) {
+    for (int level = 0; level < policy->levels; level++) {
+        long quantum = policy->quanta_us[level] * tslice_us / policy->tslice_us;
+        policy->quanta_us[level] = quantum > 0 ? quantum : 1;
+    }
+    if (policy->ops == &fair_ops) {
+        policy->latency_us = policy->latency_us * tslice_us / policy->tslice_us;
+        long granularity = policy->min_granularity_us * tslice_us / policy->tslice_us;
+        policy->min_granularity_us = granularity > 0 ? granularity : 1;
+    }
+    policy->tslice_us = tslice_us;
+}
+
+static void describe_levels(FILE *out, const char *what, const long *values_us, int levels) {
+    fprintf(out, ", %s", what);
+    for (int level = 0; level < levels; level++) {
+        fprintf(out, "%s%.1f", level == 0 ? " " : "/", values_us[level] / 1000.0);
+    }
+    fprintf(out, " ms");
+}
+
+void policy_describe(sched_policy *policy, FILE *out) {
+    fprintf(out, "Policy: %s", policy->ops->name);
+    if (policy->ops == &mlfq_ops) {
+        fprintf(out, ", %d levels", policy->levels);
+        describe_levels(out, "quanta", policy->quanta_us, policy->levels);
+        fprintf(out, ", boost every %.1f ms", policy->boost_us / 1000.0);
+    } else if (policy->ops == &prio_ops) {
+        describe_levels(out, "quanta", policy->quanta_us, policy->levels);
+        describe_levels(out, "aging", policy->aging_us, policy->levels);
+    } else if (policy->ops == &fair_ops) {
+        fprintf(out, ", latency target %.1f ms, min granularity %.1f ms", policy->latency_us / 1000.0,
+                policy->min_granularity_us / 1000.0);
+    }
+    fprintf(out, "\n");
+}
+
+void policy_destroy(sched_policy *policy) {
+    policy->ops->destroy(policy);
+}
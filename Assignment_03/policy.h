@@ -0,0 +1,134 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <getopt.h>
+
+/*
+ * Scheduling policies shared by the SimpleScheduler front ends.
+ *
+ * A policy only decides which job runs next and for how long; it never
+ * sends signals or reads clocks. The caller owns the CPU slots, charges
+ * run time to the job in its slot and asks the policy for a replacement
+ * when a slot frees up or a quantum runs out. Jobs are described by an
+ * embedded sched_job that the policy may use for its own bookkeeping.
+ */
+
+#define POLICY_MAX_LEVELS 8
+#define MIN_PRIORITY 1        // default for submit without a priority
+#define MAX_PRIORITY 4
+#define DEFAULT_SHARES 100    // stride tickets for submit without --shares
+#define MAX_SHARES 100000
+
+typedef struct sched_job {
+    int id;              // owner's index for the job
+    int priority;        // MIN_PRIORITY..MAX_PRIORITY, higher runs first
+    int level;           // run-queue level, 0 is served first, -1 until first enqueue
+    int boost_epoch;     // policy boost_epoch when level was last set
+    long slice_used_us;  // run time charged in the current quantum
+    long enqueued_us;    // policy time of the last enqueue, for aging
+    struct sched_job *next, *prev; // run-queue links, owned by the policy while queued
+    int tickets;         // stride: CPU shares, the job gets tickets / total of the CPU
+    long pass;           // stride: advances by stride_of(tickets) per quantum used
+    long runtime_us;     // fair: CPU time the job has used, kept current by the caller
+    long charged_us;     // fair: runtime_us already folded into vruntime
+    long vruntime;       // fair: runtime scaled by 1024 / weight
+    struct sched_job *rb_parent, *rb_left, *rb_right; // fair: run-queue tree links
+    bool rb_red;
+} sched_job;
+
+void sched_job_init(sched_job *job, int id, int priority);
+// Strips a trailing priority argument from "cmd args [priority]", MIN_PRIORITY if absent
+int policy_parse_priority(char *command);
+// Strips a leading "--shares N " from *command; DEFAULT_SHARES if absent, -1 if N is invalid
+int policy_parse_shares(char **command);
+// Parses a submit-batch manifest line "<arrival_ms> <priority> [--shares N] <command...>",
+// where # starts a comment. Returns 1 for a job, 0 for a blank line and -1 if it is malformed.
+int policy_parse_batch_line(char *line, double *arrival_ms, int *priority, int *shares, char **command);
+
+typedef struct sched_policy sched_policy;
+
+typedef struct {
+    const char *name;
+    // Makes a job runnable: newly submitted or just preempted
+    void (*enqueue)(sched_policy *policy, sched_job *job);
+    // Removes and returns the job to run next, NULL when nothing is queued
+    sched_job *(*pick_next)(sched_policy *policy);
+    // Run time the job may use before it is preempted
+    long (*quantum_us)(sched_policy *policy, sched_job *job);
+    // The job used up its whole quantum
+    void (*expired)(sched_policy *policy, sched_job *job);
+    // Whether a queued job should take the slot of this running job right away
+    bool (*preempts)(sched_policy *policy, sched_job *running);
+    // Called once per scheduler tick with the time since startup
+    void (*tick)(sched_policy *policy, long now_us);
+    // Frees the policy and anything it allocated; queued jobs belong to the caller
+    void (*destroy)(sched_policy *policy);
+} sched_policy_ops;
+
+// FIFO threaded through the jobs themselves, so queues never fill up
+typedef struct {
+    sched_job *head;
+    sched_job *tail;
+    int count;
+} job_queue;
+
+struct sched_policy {
+    const sched_policy_ops *ops;
+    long tslice_us;
+    int levels;
+    long quanta_us[POLICY_MAX_LEVELS];
+    long boost_us;        // 0 disables the periodic priority boost
+    long last_boost_us;
+    int boost_epoch;
+    long aging_us[POLICY_MAX_LEVELS]; // max wait on a level before moving up one
+    long now_us;          // time of the last tick
+    int nr_queued;
+    unsigned int ready_mask; // bit l set when queues[l] is not empty
+    job_queue queues[POLICY_MAX_LEVELS];
+    sched_job **heap;     // stride: min-heap on pass, nr_queued entries
+    int heap_capacity;
+    long pass_floor;      // stride: pass of the last job picked
+    sched_job *rb_root;   // fair: red-black tree ordered by vruntime
+    sched_job *rb_leftmost;
+    long min_vruntime;    // fair: vruntime of the last job picked
+    long total_weight;    // fair: weights of the queued jobs
+    long latency_us;      // fair: period in which every queued job should run once
+    long min_granularity_us; // fair: shortest quantum handed out
+};
+
+// Startup selection, filled from the command line
+typedef struct {
+    const char *name;                  // "prio", "rr", "mlfq", "stride" or "fair"
+    int levels;
+    long quanta_us[POLICY_MAX_LEVELS]; // 0 means the policy's default
+    long boost_us;                     // -1 means the default period
+    long aging_us[POLICY_MAX_LEVELS];  // 0 means the policy's default
+    long latency_us;                   // 0 means the policy's default
+    long min_granularity_us;           // 0 means the policy's default
+} policy_config;
+
+// getopt_long entries for the policy options; option values start at POLICY_OPT_BASE
+#define POLICY_OPT_BASE 0x100
+#define POLICY_LONG_OPTIONS \
+    {"policy", required_argument, NULL, POLICY_OPT_BASE}, \
+    {"levels", required_argument, NULL, POLICY_OPT_BASE + 1}, \
+    {"quanta", required_argument, NULL, POLICY_OPT_BASE + 2}, \
+    {"boost", required_argument, NULL, POLICY_OPT_BASE + 3}, \
+    {"aging", required_argument, NULL, POLICY_OPT_BASE + 4}, \
+    {"latency-target", required_argument, NULL, POLICY_OPT_BASE + 5}, \
+    {"min-granularity", required_argument, NULL, POLICY_OPT_BASE + 6}
+
+void policy_config_init(policy_config *config);
+// Applies one policy option returned by getopt_long; returns false if arg is invalid
+bool policy_config_option(policy_config *config, int opt, const char *arg);
+void policy_usage(FILE *out);
+// Returns NULL if config names an unknown policy
+sched_policy *policy_create(const policy_config *config, long tslice_us);
+void policy_describe(sched_policy *policy, FILE *out);
+void policy_destroy(sched_policy *policy);
+// Changes the slice length at runtime; quanta scale with it, aging limits do not
+void policy_set_tslice(sched_policy *policy, long tslice_us);
+
+#endif
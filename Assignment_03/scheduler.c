@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -7,44 +8,240 @@
 #include <sys/time.h>
 #include <stdbool.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include <getopt.h>
+#include "policy.h"
+#include "trace.h"
+#include "stats.h"
+#include "pidfd.h"
 
 #define BUFFER_SIZE 100
-#define HISTORY_SIZE 100
+#define INITIAL_JOBS 64    // job table capacity before the first doubling
+#define PID_BUCKETS 4096   // pid lookup buckets, a power of two
 #define MAX_CPU 4
-#define OUTPUT_SIZE 1000
+#define OUTPUT_CHUNK 65536 // bytes read from a job pipe per read()
+#define OUTPUT_MEMORY_LIMIT (1 << 20) // output kept in memory per job before spilling to a file
+#define MIN_TSLICE_US 100 // Shortest time slice the tick loop supports
+#define MAX_EVENTS 16
+#define BALANCE_TICKS 8 // slices between load balancing passes
+#define MAX_GANG 64 // processes of one job that are tracked
+#define DEFAULT_TRACE_EVENTS (1 << 20)
 
-typedef struct {
+// getopt_long values for the scheduler's own options, above the policy ones
+enum {
+    OPT_TRACE = 0x200,
+    OPT_TRACE_EVENTS,
+    OPT_JOBS_CSV,
+    OPT_NO_BLOCK_DETECT,
+    OPT_ADAPTIVE,
+    OPT_SLICE_MIN,
+    OPT_SLICE_MAX,
+    OPT_TARGET_LATENCY,
+    OPT_BATCH,
+    OPT_METRICS_SOCKET,
+};
+
+// Tags stored in epoll_event.data.u32 to tell event sources apart
+enum event_source {
+    EV_STDIN,
+    EV_TICK,
+    EV_SAMPLE, // mid-slice check for blocked and woken jobs
+    EV_METRICS, // connection on the metrics socket
+    EV_JOB_OUTPUT, // EV_JOB_OUTPUT + i is the output pipe of command_history[i]
+};
+#define EV_JOB_EXIT 0x80000000u // EV_JOB_EXIT | i is the pidfd of command_history[i]
+
+typedef struct command_info {
     char *command;
     int pid;
     struct timeval start_time;
     struct timeval end_time;
     long duration;
-    long wait_time;
-    char output[OUTPUT_SIZE]; // Store the output of the command
+    // Accounting in CLOCK_MONOTONIC microseconds
+    long submit_us;
+    long first_run_us; // -1 until first dispatched
+    long exec_us; // when the child was released to exec, -1 until its launch record arrives
+    long end_us;
+    long queued_since_us; // when the job last entered a run queue
+    long wait_us; // total time spent runnable in a run queue
+    long cpu_us; // user + system time from wait4()
+    int slices; // time slices the job held a CPU slot for
+    double entitled_slices; // stride: slices its tickets entitled it to while runnable
+    // Output is drained from the pipe as the job writes it; anything past
+    // OUTPUT_MEMORY_LIMIT goes to spill_path instead of memory
+    char *output;
+    size_t output_length;
+    size_t output_capacity;
+    long output_total; // bytes received, including spilled ones
+    int output_fd; // Read end of the output pipe until end of file, -1 afterwards
+    int pid_fd; // pidfd watched for the exit, -1 once reaped or if it could not be opened
+    int spill_fd;
+    char *spill_path;
+    int slot; // CPU slot the job holds, -1 when it has none
+    int trace_slot; // Slot of the job's open run span in the trace, -1 if none
+    int cpu; // Slot whose run queue owns the job and whose core it is pinned to
+    bool on_cpu; // Last signal sent was SIGCONT, so the job is not stopped
+    int blocked_index; // Position in blocked_jobs, -1 unless the job gave up its slot to wait
+    int processes; // Most processes seen in the job at once
+    sched_job sj; // Scheduling state owned by the policy
+    struct command_info *pid_next; // pid_table chain
 } command_info;
 
-command_info command_history[HISTORY_SIZE];
+// Jobs are allocated one by one so pointers to them stay valid as the table grows
+command_info **command_history;
 int history_count = 0;
+int history_capacity = 0;
+int active_jobs = 0; // submitted jobs that have not been reaped yet
+command_info *pid_table[PID_BUCKETS]; // live jobs by pid, for reaping
+volatile sig_atomic_t child_exited = 0;
+int unwatched_jobs = 0; // active jobs without a pidfd, reaped after SIGCHLD instead
+long sigchld_reaped = 0; // jobs whose exit was found by the SIGCHLD fallback
+long pidfd_budget = MAX_PIDFDS; // lowered for small fd limits, so output pipes get most of them
+int epoll_fd; // Event loop: stdin, the tick timer and every job's output pipe
 int NCPU = 1; // Number of CPU cores
-int TSLICE = 1000; // Time slice in milliseconds
-int ready_queue[HISTORY_SIZE];
-int queue_count = 0;//number if ekements
-bool running = true;
+long TSLICE_US = 1000000; // Time slice in microseconds
+// Each slot has its own run queue and core. Jobs stay on their slot's
+// queue so they keep running on a warm cache; an idle slot steals from the
+// busiest queue and a periodic pass evens out queue lengths.
+sched_policy **runqueues; // NCPU entries, decides which queued job gets the slot next
+command_info **cpu_slots; // NCPU entries, the job running on each slot or NULL
+int *slot_cores; // NCPU entries, the core each slot's jobs are pinned to
+long steals = 0; // jobs an idle slot took from another queue
+// A job found sleeping in the kernel (I/O, sleep, pipe...) gives up its
+// slot but is not stopped, so its wait can complete. It is watched here
+// until it turns runnable again and then goes back to a run queue.
+bool share_accounting = false; // stride policy: track slices each job was entitled to
+bool measure_runtime = false; // fair policy: charge jobs their measured CPU time
+bool detect_blocked = true;
+command_info **blocked_jobs;
+int nblocked = 0;
+int blocked_capacity = 0;
+long block_releases = 0;
+long block_wakeups = 0;
+long migrations = 0; // jobs moved between queues, by stealing or balancing
+bool running = true; // Cleared on Ctrl+C or end of input; jobs still run to completion
 bool ctrl_c_flag = false;
 
+// Measured tick timing, compared against TSLICE_US in the exit report
+typedef struct {
+    struct timespec start;  // when the first slice began
+    struct timespec base;   // when the timers were last armed
+    long base_ticks;        // ticks before base
+    struct timespec last;   // when the previous tick was handled
+    long ticks;             // timer expirations so far, including missed ones
+    long handled;           // expirations handled by scheduler_tick()
+    long missed;            // expirations that passed while the loop was busy
+    double interval_sum_us; // sum of measured intervals between handled ticks
+    double interval_min_us;
+    double interval_max_us;
+    double max_lateness_us; // worst delay of a tick behind its ideal start + n * TSLICE
+    double work_sum_us;     // CPU time spent inside scheduler_tick()
+    double work_max_us;
+    double last_work_us;
+    long signals;           // SIGSTOP/SIGCONT sent by the scheduler
+} tick_stats;
+
+tick_stats tick_info;
+
+// Dispatch latency bucket bounds in microseconds, for the metrics socket
+static const long dispatch_bounds_us[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 10000000,
+};
+#define DISPATCH_BUCKETS (int)(sizeof(dispatch_bounds_us) / sizeof(dispatch_bounds_us[0]))
+
+// Counters served on the metrics socket
+typedef struct {
+    long dispatch_buckets[DISPATCH_BUCKETS]; // dispatches per bucket, beyond the last bound only in dispatches
+    long dispatches;
+    double dispatch_sum_us;
+    long stops; // SIGSTOP sent to job process groups
+    long conts; // SIGCONT sent to job process groups
+} metrics_stats;
+
+metrics_stats metrics;
+int tick_fd = -1; // Periodic tick timer
+int sample_fd = -1; // Mid-slice timer, only while detecting blocked jobs
+
+/*
+ * Adaptive time slice. Every ADAPT_TICKS ticks the slice is recomputed as
+ * the target latency divided by the run queue depth per slot, so a queued
+ * job waits about one target latency for its turn. It never goes below the
+ * length at which the measured scheduling work (tick handling including the
+ * SIGSTOP/SIGCONT syscalls) would exceed MAX_OVERHEAD of the slice, and it
+ * stays within the configured bounds.
+ */
+#define ADAPT_TICKS 4
+#define MAX_OVERHEAD 0.02       // scheduling CPU allowed per slice
+#define ADAPT_HYSTERESIS 0.1    // smaller relative changes are ignored
+#define DEFAULT_SLICE_MIN_US 1000
+#define DEFAULT_SLICE_MAX_US 100000
+#define DEFAULT_TARGET_LATENCY_US 50000
+#define SLICE_HISTORY_SHOWN 40
+
+typedef struct {
+    long at_us;       // time since startup
+    long slice_us;
+    int queued;       // jobs waiting in all run queues
+    double overhead_us;
+} slice_change;
+
+typedef struct {
+    bool enabled;
+    long min_us;
+    long max_us;
+    long target_latency_us;
+    long initial_us;
+    double overhead_us;    // moving average of scheduling CPU per tick
+    double signal_sum_us;  // time spent in kill() for SIGSTOP/SIGCONT
+    slice_change *history;
+    int nhistory;
+    int capacity;
+} adaptive_slice;
+
+adaptive_slice adaptive;
+
+// Batch jobs launched but held back until their arrival offset
+typedef struct {
+    long arrival_us;
+    command_info *job;
+} pending_arrival;
+
+pending_arrival *arrivals; // sorted by arrival_us from next_arrival on
+int narrivals = 0;
+int next_arrival = 0;
+int arrivals_capacity = 0;
+
 // Function to display command information
 void display_command_info() {
     printf("\nDisplaying command info...\n");
     for (int i = 0; i < history_count; i++) {
-        printf("Command: %s\n", command_history[i].command);
-        printf("PID: %d\n", command_history[i].pid);
-        printf("Start time: %ld.%06ld\n", (long)command_history[i].start_time.tv_sec, (long)command_history[i].start_time.tv_usec);
-        printf("Completion time: %ld.%06ld\n", (long)command_history[i].end_time.tv_sec, (long)command_history[i].end_time.tv_usec);
-        printf("Wait time: %ld ms\n", command_history[i].duration);
-        //printf("Wait time: %ld ms\n", command_history[i].wait_time);
-        printf("Output:%s\n", command_history[i].output);
+        printf("Command: %s\n", command_history[i]->command);
+        printf("PID: %d\n", command_history[i]->pid);
+        printf("Priority: %d\n", command_history[i]->sj.priority);
+        printf("Start time: %ld.%06ld\n", (long)command_history[i]->start_time.tv_sec, (long)command_history[i]->start_time.tv_usec);
+        printf("Completion time: %ld.%06ld\n", (long)command_history[i]->end_time.tv_sec, (long)command_history[i]->end_time.tv_usec);
+        printf("Wait time: %.3f ms\n", command_history[i]->wait_us / 1000.0);
+        printf("Response time: %.3f ms\n", (command_history[i]->first_run_us - command_history[i]->submit_us) / 1000.0);
+        printf("Turnaround time: %.3f ms\n", (command_history[i]->end_us - command_history[i]->submit_us) / 1000.0);
+        printf("CPU time: %.3f ms in %d slices\n", command_history[i]->cpu_us / 1000.0, command_history[i]->slices);
+        printf("Output:%.*s\n", (int)command_history[i]->output_length,
+               command_history[i]->output != NULL ? command_history[i]->output : "");
+        if (command_history[i]->spill_path != NULL) {
+            printf("(%ld bytes in total, full output in %s)\n", command_history[i]->output_total,
+                   command_history[i]->spill_path);
+        }
         printf("------------------------\n");
-        free(command_history[i].command); // Free allocated memory
+        free(command_history[i]->command); // Free allocated memory
+        free(command_history[i]->output);
     }
 }
 
@@ -54,51 +251,255 @@ void sigint_handler(int sig_num) {
     running = false;
 }
 
-// Signal handler for child process termination
+// Signal handler for child process termination; the event loop does the reaping
 void sigchld_handler(int sig_num) {
-    int status;
-    pid_t pid;
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        for (int i = 0; i < history_count; i++) {
-            if (command_history[i].pid == pid) {
-                struct timeval end;
-                gettimeofday(&end, NULL);
-                command_history[i].end_time = end;
-                command_history[i].duration = (end.tv_sec - command_history[i].start_time.tv_sec) * 1000 + (end.tv_usec - command_history[i].start_time.tv_usec) / 1000;
-
-                // Read output from the pipe
-                char buffer[OUTPUT_SIZE];
-                int n = read(command_history[i].output[0], buffer, OUTPUT_SIZE - 1);
-                if (n > 0) {
-                    buffer[n] = '\0';
-                    strncpy(command_history[i].output, buffer, OUTPUT_SIZE - 1);
-                }
-                close(command_history[i].output[0]); // Close read end of the pipe
-
-                break;
+    child_exited = 1;
+}
+
+long monotonic_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000L + now.tv_nsec / 1000;
+}
+
+// CPU time the process has used so far, -1 once it is gone
+long process_cpu_us(pid_t pid) {
+    clockid_t clock;
+    struct timespec used;
+    if (clock_getcpuclockid(pid, &clock) != 0 || clock_gettime(clock, &used) == -1) return -1;
+    return used.tv_sec * 1000000L + used.tv_nsec / 1000;
+}
+
+// Appends a zeroed job to the table, doubling the table when it is full
+command_info *new_command_info() {
+    if (history_count == history_capacity) {
+        history_capacity = history_capacity == 0 ? INITIAL_JOBS : history_capacity * 2;
+        command_history = realloc(command_history, history_capacity * sizeof(command_info *));
+        if (command_history == NULL) {
+            perror("Error growing job table\n");
+            exit(1);
+        }
+    }
+    command_info *job = calloc(1, sizeof(command_info));
+    if (job == NULL) {
+        perror("Error allocating job\n");
+        exit(1);
+    }
+    command_history[history_count++] = job;
+    return job;
+}
+
+void pid_table_add(command_info *job) {
+    command_info **bucket = &pid_table[job->pid & (PID_BUCKETS - 1)];
+    job->pid_next = *bucket;
+    *bucket = job;
+}
+
+// Removes and returns the live job with this pid, NULL if it is not ours
+command_info *pid_table_take(pid_t pid) {
+    for (command_info **link = &pid_table[pid & (PID_BUCKETS - 1)]; *link != NULL; link = &(*link)->pid_next) {
+        command_info *job = *link;
+        if (job->pid == pid) {
+            *link = job->pid_next;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+// Spreads the slots over the cores this process may run on, one core each while they last
+void assign_slot_cores() {
+    cpu_set_t allowed;
+    int cores[CPU_SETSIZE];
+    int ncores = 0;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &allowed)) cores[ncores++] = c;
+        }
+    }
+    slot_cores = malloc(NCPU * sizeof(int));
+    for (int s = 0; s < NCPU; s++) {
+        slot_cores[s] = ncores > 0 ? cores[s % ncores] : -1;
+    }
+}
+
+// Collects the leader and its descendants through /proc/<pid>/task/<pid>/children,
+// which lists the children forked by each process's main thread
+int job_processes(command_info *job, pid_t *pids) {
+    int count = 0;
+    pids[count++] = job->pid;
+    for (int i = 0; i < count && count < MAX_GANG; i++) {
+        char path[64], buffer[1024];
+        snprintf(path, sizeof(path), "/proc/%d/task/%d/children", pids[i], pids[i]);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) continue;
+        ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+        if (n <= 0) continue;
+        buffer[n] = '\0';
+        char *cursor = buffer, *end;
+        while (count < MAX_GANG) {
+            long pid = strtol(cursor, &end, 10);
+            if (end == cursor) break;
+            pids[count++] = pid;
+            cursor = end;
+        }
+    }
+    if (count > job->processes) job->processes = count;
+    return count;
+}
+
+// Moves a job onto a slot's queue and core. Processes the job forks later
+// inherit the mask, so only a job that has already run needs the walk.
+void pin_job(command_info *job, int cpu) {
+    if (job->cpu == cpu) return;
+    if (job->cpu >= 0) migrations++;
+    job->cpu = cpu;
+    if (slot_cores[cpu] < 0) return;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(slot_cores[cpu], &mask);
+    pid_t pids[MAX_GANG];
+    int n = job->first_run_us < 0 ? 1 : job_processes(job, pids);
+    pids[0] = job->pid;
+    for (int i = 0; i < n; i++) {
+        sched_setaffinity(pids[i], sizeof(mask), &mask); // fails harmlessly if the process already exited
+    }
+}
+
+int cpu_load(int cpu) {
+    return runqueues[cpu]->nr_queued + (cpu_slots[cpu] != NULL);
+}
+
+int least_loaded_cpu() {
+    int best = 0;
+    for (int s = 1; s < NCPU; s++) {
+        if (cpu_load(s) < cpu_load(best)) best = s;
+    }
+    return best;
+}
+
+int busiest_queue() {
+    int best = 0;
+    for (int s = 1; s < NCPU; s++) {
+        if (runqueues[s]->nr_queued > runqueues[best]->nr_queued) best = s;
+    }
+    return best;
+}
+
+// Returns false for descriptors epoll cannot watch, such as regular files
+bool add_event_source(int fd, uint32_t source) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = source;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        if (errno == EPERM) return false;
+        perror("epoll_ctl");
+        exit(1);
+    }
+    return true;
+}
+
+// Appends to the job's output, switching to a spill file once memory is used up
+void store_output(command_info *job, const char *data, size_t n) {
+    job->output_total += n;
+    if (job->spill_fd < 0 && job->output_length + n > OUTPUT_MEMORY_LIMIT) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/scheduler-%d-XXXXXX", job->pid);
+        job->spill_fd = mkstemp(path);
+        if (job->spill_fd == -1) {
+            perror("Error creating spill file\n");
+            exit(1);
+        }
+        job->spill_path = strdup(path);
+        // The spill file holds the whole output; memory keeps the first part for the report
+        if (write(job->spill_fd, job->output, job->output_length) == -1) perror("Error writing spill file\n");
+    }
+    if (job->spill_fd >= 0) {
+        if (write(job->spill_fd, data, n) == -1) perror("Error writing spill file\n");
+        return;
+    }
+    if (job->output_length + n > job->output_capacity) {
+        size_t capacity = job->output_capacity == 0 ? 4096 : job->output_capacity;
+        while (capacity < job->output_length + n) capacity *= 2;
+        job->output = realloc(job->output, capacity);
+        if (job->output == NULL) {
+            perror("Error growing output buffer\n");
+            exit(1);
+        }
+        job->output_capacity = capacity;
+    }
+    memcpy(job->output + job->output_length, data, n);
+    job->output_length += n;
+}
+
+// Reads everything the job's pipe holds right now; closes it at end of file
+void drain_output(command_info *job) {
+    static char buffer[OUTPUT_CHUNK];
+    while (job->output_fd >= 0) {
+        ssize_t n = read(job->output_fd, buffer, sizeof(buffer));
+        if (n > 0 && job->exec_us < 0) {
+            // The launch record is the first write and shorter than PIPE_BUF, so it arrives whole
+            if (n < (ssize_t)sizeof(job->exec_us)) continue;
+            memcpy(&job->exec_us, buffer, sizeof(job->exec_us));
+            if (n > (ssize_t)sizeof(job->exec_us)) store_output(job, buffer + sizeof(job->exec_us), n - sizeof(job->exec_us));
+        }
+        else if (n > 0) {
+            store_output(job, buffer, n);
+        }
+        else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, job->output_fd, NULL); // children not yet exec'd share the file
+            close(job->output_fd);
+            job->output_fd = -1;
+            if (job->spill_fd >= 0) {
+                close(job->spill_fd);
+                job->spill_fd = -1;
             }
         }
+        else if (errno == EAGAIN) {
+            return;
+        }
     }
 }
 
 // function to execute a command
-void execute_command(char *command) {
+/*
+ * Launch handshake: SIGCONT is blocked from before the fork, so the first
+ * dispatch's SIGCONT stays pending in the child until sigwaitinfo() takes
+ * it, however early it is sent. The child then writes the time it woke up
+ * to its output pipe ahead of the job's own output, which gives the launch
+ * latency from dispatch to exec without another file descriptor.
+ */
+command_info *execute_command(char *command, int priority, int shares) {
     int output_pipe[2];
-    if (pipe(output_pipe) == -1) {
+    if (pipe2(output_pipe, O_CLOEXEC | O_NONBLOCK) == -1) {
         perror("Error creating pipe\n");
         exit(1);
     }
 
+    sigset_t start_signal, old_mask;
+    sigemptyset(&start_signal);
+    sigaddset(&start_signal, SIGCONT);
+    sigprocmask(SIG_BLOCK, &start_signal, &old_mask);
     int id = fork();
     if (id < 0) {
         perror("Error during fork\n");
         exit(1);
     }
     else if (id == 0) {
+        setpgid(0, 0); // The job and everything it starts form one group
         close(output_pipe[0]); // Close read end of the pipe in the child
+        // The shell's input carries commands, and a background group reading the terminal would stop
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd != -1) {
+            dup2(null_fd, STDIN_FILENO);
+            close(null_fd);
+        }
         dup2(output_pipe[1], STDOUT_FILENO); // Redirect stdout to the pipe
         dup2(output_pipe[1], STDERR_FILENO); // Redirect stderr to the pipe
         close(output_pipe[1]); // Close write end of the pipe in the child
+        // Only the parent's read end should be non-blocking
+        fcntl(STDOUT_FILENO, F_SETFL, fcntl(STDOUT_FILENO, F_GETFL) & ~O_NONBLOCK);
 
         char *args[BUFFER_SIZE];
         char *token = strtok(command, " ");
@@ -108,108 +509,1096 @@ void execute_command(char *command) {
             token = strtok(NULL, " ");
         }
         args[i] = NULL;
-        pause(); // wait for signal from SimpleScheduler
+        while (sigwaitinfo(&start_signal, NULL) == -1) {} // wait for the first dispatch
+        long woke_us = monotonic_us();
+        if (write(STDOUT_FILENO, &woke_us, sizeof(woke_us)) == -1) exit(1);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
         if (execvp(args[0], args) == -1) {
             perror("Execution failed\n");
             exit(1);
         }
     }
     else {
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
         close(output_pipe[1]); // Close write end of the pipe in the parent
+        setpgid(id, id); // Also here, so the group exists before the first killpg
+
+        command_info *job = new_command_info();
+        job->pid = id;
+        job->command = strdup(command);
+        job->duration = -1;
+        job->first_run_us = -1;
+        job->exec_us = -1;
+        job->output_fd = output_pipe[0];
+        job->spill_fd = -1;
+        add_event_source(job->output_fd, EV_JOB_OUTPUT + history_count - 1);
+        job->pid_fd = active_jobs - unwatched_jobs < pidfd_budget ? open_pidfd(id) : -1;
+        if (job->pid_fd >= 0) {
+            add_event_source(job->pid_fd, EV_JOB_EXIT | (history_count - 1));
+        }
+        else {
+            unwatched_jobs++;
+        }
+        job->slot = -1;
+        job->trace_slot = -1;
+        job->on_cpu = false;
+        job->blocked_index = -1;
+        job->processes = 1;
+        job->cpu = -1;
+        sched_job_init(&job->sj, history_count - 1, priority);
+        job->sj.tickets = shares;
+        pid_table_add(job);
+        active_jobs++;
+        return job;
+    }
+    return NULL; // the child execs or exits above
+}
+
+// Makes a launched job runnable; its accounting starts here
+void enqueue_job(command_info *job) {
+    gettimeofday(&job->start_time, NULL);
+    job->submit_us = monotonic_us();
+    job->queued_since_us = job->submit_us;
+    int cpu = least_loaded_cpu();
+    pin_job(job, cpu);
+    runqueues[cpu]->ops->enqueue(runqueues[cpu], &job->sj);
+    trace_record(TRACE_SUBMIT, job->sj.id, job->pid, cpu);
+}
+
+long timespec_diff_us(struct timespec *a, struct timespec *b) {
+    return (a->tv_sec - b->tv_sec) * 1000000L + (a->tv_nsec - b->tv_nsec) / 1000;
+}
+
+// Stops or continues the job's whole process group, so helpers it forks and
+// pipelines it starts are scheduled together with it
+void signal_job(command_info *job, int sig) {
+    struct timespec before, after;
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    killpg(job->pid, sig);
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    adaptive.signal_sum_us += (after.tv_sec - before.tv_sec) * 1e6 + (after.tv_nsec - before.tv_nsec) / 1e3;
+    job->on_cpu = sig == SIGCONT;
+    tick_info.signals++;
+    if (sig == SIGSTOP) metrics.stops++;
+    else metrics.conts++;
+}
+
+void record_dispatch_latency(long latency_us) {
+    int b = 0;
+    while (b < DISPATCH_BUCKETS && latency_us > dispatch_bounds_us[b]) b++;
+    if (b < DISPATCH_BUCKETS) metrics.dispatch_buckets[b]++;
+    metrics.dispatches++;
+    metrics.dispatch_sum_us += latency_us;
+}
+
+// Puts queued jobs on idle slots, resuming only those that are stopped.
+// A slot whose own queue is empty steals from the busiest one.
+void fill_free_slots() {
+    for (int s = 0; s < NCPU; s++) {
+        while (cpu_slots[s] == NULL) {
+            sched_job *next = runqueues[s]->ops->pick_next(runqueues[s]);
+            if (next == NULL) {
+                int victim = busiest_queue();
+                next = runqueues[victim]->ops->pick_next(runqueues[victim]);
+                if (next == NULL) return; // nothing queued anywhere
+                steals++;
+            }
+            command_info *job = command_history[next->id];
+            if (job->duration != -1) continue; // terminated while queued
+            pin_job(job, s);
+            long now = monotonic_us();
+            job->wait_us += now - job->queued_since_us;
+            record_dispatch_latency(now - job->queued_since_us);
+            if (job->first_run_us < 0) job->first_run_us = now;
+            if (!job->on_cpu) signal_job(job, SIGCONT);
+            // A job preempted this tick may be picked again for its own slot; its span goes on
+            if (job->trace_slot != s) {
+                if (job->trace_slot >= 0) trace_record(TRACE_PREEMPT, next->id, job->pid, job->trace_slot);
+                trace_record(TRACE_DISPATCH, next->id, job->pid, s);
+                job->trace_slot = s;
+            }
+            job->slot = s;
+            cpu_slots[s] = job;
+        }
+    }
+}
+
+// Moves queued jobs from the longest queue to the shortest until no two
+// slots differ in load by more than one job
+void balance_queues() {
+    for (;;) {
+        int from = busiest_queue();
+        int to = least_loaded_cpu();
+        if (cpu_load(from) - cpu_load(to) <= 1) return;
+        sched_job *moved = runqueues[from]->ops->pick_next(runqueues[from]);
+        command_info *job = command_history[moved->id];
+        pin_job(job, to);
+        runqueues[to]->ops->enqueue(runqueues[to], &job->sj);
+    }
+}
+
+// State letter from /proc/<pid>/stat (R, S, D, T, Z...), or 0 if it cannot be read
+char job_state(pid_t pid) {
+    char path[32], buffer[512];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return 0;
+    ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buffer[n] = '\0';
+    char *end = strrchr(buffer, ')'); // the command name may contain spaces and parentheses
+    return end != NULL && end[1] == ' ' ? end[2] : 0;
+}
+
+// A job is runnable while any of its processes is, e.g. a shell waiting for its pipeline
+char gang_state(command_info *job) {
+    char state = job_state(job->pid);
+    if (state == 'R' || state == 0) return state;
+    pid_t pids[MAX_GANG];
+    int n = job_processes(job, pids);
+    for (int i = 1; i < n; i++) {
+        if (job_state(pids[i]) == 'R') return 'R';
+    }
+    return state;
+}
+
+void blocked_add(command_info *job) {
+    if (nblocked == blocked_capacity) {
+        blocked_capacity = blocked_capacity == 0 ? INITIAL_JOBS : blocked_capacity * 2;
+        blocked_jobs = realloc(blocked_jobs, blocked_capacity * sizeof(command_info *));
+        if (blocked_jobs == NULL) {
+            perror("Error growing blocked list\n");
+            exit(1);
+        }
+    }
+    job->blocked_index = nblocked;
+    blocked_jobs[nblocked++] = job;
+}
+
+void blocked_remove(command_info *job) {
+    command_info *last = blocked_jobs[--nblocked];
+    blocked_jobs[job->blocked_index] = last;
+    last->blocked_index = job->blocked_index;
+    job->blocked_index = -1;
+}
+
+/*
+ * Frees the slots of running jobs that are asleep in the kernel and
+ * requeues blocked jobs that have woken up. A woken job runs unmanaged
+ * until the next sample, at most half a slice; it keeps running if it gets
+ * a free slot straight away and is stopped otherwise.
+ */
+void sample_job_states() {
+    for (int s = 0; s < NCPU; s++) {
+        command_info *job = cpu_slots[s];
+        if (job == NULL || job->first_run_us < 0) continue;
+        char state = gang_state(job);
+        if (state != 'S' && state != 'D') continue;
+        trace_record(TRACE_BLOCK, job->sj.id, job->pid, s);
+        job->trace_slot = -1;
+        cpu_slots[s] = NULL;
+        job->slot = -1;
+        blocked_add(job);
+        block_releases++;
+    }
+
+    command_info *woken[nblocked > 0 ? nblocked : 1];
+    int nwoken = 0;
+    for (int i = 0; i < nblocked; i++) {
+        command_info *job = blocked_jobs[i];
+        if (gang_state(job) != 'R') continue; // still waiting, or exited and about to be reaped
+        blocked_remove(job);
+        i--;
+        job->queued_since_us = monotonic_us();
+        runqueues[job->cpu]->ops->enqueue(runqueues[job->cpu], &job->sj);
+        woken[nwoken++] = job;
+        block_wakeups++;
+    }
+
+    fill_free_slots();
+    for (int i = 0; i < nwoken; i++) {
+        if (woken[i]->slot == -1) signal_job(woken[i], SIGSTOP);
+    }
+}
+
+int compare_arrivals(const void *a, const void *b) {
+    long x = ((const pending_arrival *)a)->arrival_us, y = ((const pending_arrival *)b)->arrival_us;
+    return (x > y) - (x < y);
+}
+
+void add_arrival(command_info *job, long arrival_us) {
+    if (narrivals == arrivals_capacity) {
+        arrivals_capacity = arrivals_capacity == 0 ? INITIAL_JOBS : arrivals_capacity * 2;
+        arrivals = realloc(arrivals, arrivals_capacity * sizeof(pending_arrival));
+        if (arrivals == NULL) {
+            perror("Error growing arrival list\n");
+            exit(1);
+        }
+    }
+    arrivals[narrivals].job = job;
+    arrivals[narrivals++].arrival_us = arrival_us;
+}
+
+// Enqueues the batch jobs whose arrival offset has passed
+void release_arrivals(long now_us) {
+    while (next_arrival < narrivals && arrivals[next_arrival].arrival_us <= now_us) {
+        command_info *job = arrivals[next_arrival++].job;
+        if (job->duration == -1) enqueue_job(job);
+    }
+    if (next_arrival == narrivals) next_arrival = narrivals = 0;
+}
+
+/*
+ * Runs a manifest of policy_parse_batch_line() lines. Every job is forked up front and held before
+ * exec; the ones due now are enqueued together and placed on slots with a
+ * single fill, the rest are released by the tick once their offset passes.
+ */
+void submit_batch(const char *path) {
+    FILE *manifest = fopen(path, "r");
+    if (manifest == NULL) {
+        perror(path);
+        return;
+    }
+    long start_us = monotonic_us();
+    char *line = NULL;
+    size_t size = 0;
+    int count = 0, line_number = 0;
+    while (getline(&line, &size, manifest) != -1) {
+        line_number++;
+        double arrival_ms;
+        int priority, shares;
+        char *command;
+        int parsed = policy_parse_batch_line(line, &arrival_ms, &priority, &shares, &command);
+        if (parsed == 0) continue;
+        if (parsed < 0) {
+            fprintf(stderr, "%s:%d: expected <arrival_ms> <priority> [--shares N] <command>\n", path, line_number);
+            continue;
+        }
+        command_info *job = execute_command(command, priority, shares);
+        if (arrival_ms > 0) {
+            add_arrival(job, start_us + (long)(arrival_ms * 1000));
+        }
+        else {
+            enqueue_job(job);
+        }
+        count++;
+    }
+    free(line);
+    fclose(manifest);
+    qsort(arrivals + next_arrival, narrivals - next_arrival, sizeof(pending_arrival), compare_arrivals);
+    fill_free_slots();
+    long elapsed_us = monotonic_us() - start_us;
+    printf("Submitted %d jobs from %s in %.3f ms (%.1f us per job)\n", count, path, elapsed_us / 1000.0,
+           count > 0 ? (double)elapsed_us / count : 0.0);
+}
+
+// Splits the slice that just ended on each slot among its runnable jobs by tickets
+void charge_entitlements() {
+    for (int s = 0; s < NCPU; s++) {
+        command_info *running = cpu_slots[s];
+        sched_policy *policy = runqueues[s];
+        if (running == NULL) continue;
+        long tickets = running->sj.tickets;
+        for (int i = 0; i < policy->nr_queued; i++) {
+            tickets += policy->heap[i]->tickets;
+        }
+        running->entitled_slices += (double)running->sj.tickets / tickets;
+        for (int i = 0; i < policy->nr_queued; i++) {
+            command_history[policy->heap[i]->id]->entitled_slices += (double)policy->heap[i]->tickets / tickets;
+        }
+    }
+}
+
+// Runs once per time slice from the event loop, never from signal context
+void scheduler_tick(long now_us) {
+    command_info *preempted[NCPU];
+    int preempted_slot[NCPU];
+    int npreempted = 0;
+
+    if (narrivals > 0) release_arrivals(monotonic_us());
+    if (share_accounting) charge_entitlements();
+
+    // Charge the slice that just ended to every running job
+    for (int s = 0; s < NCPU; s++) {
+        command_info *job = cpu_slots[s];
+        if (job == NULL) continue;
+        sched_policy *policy = runqueues[s];
+        job->slices++;
+        job->sj.slice_used_us += TSLICE_US;
+        if (measure_runtime) {
+            long used_us = process_cpu_us(job->pid);
+            if (used_us >= 0) job->sj.runtime_us = used_us;
+        }
+        bool expired = job->sj.slice_used_us >= policy->ops->quantum_us(policy, &job->sj);
+        if (expired) {
+            policy->ops->expired(policy, &job->sj);
+            job->sj.slice_used_us = 0;
+        }
+        // Only give up the slot if something else is waiting for it
+        if ((expired && policy->nr_queued > 0) || policy->ops->preempts(policy, &job->sj)) {
+            policy->ops->enqueue(policy, &job->sj);
+            job->queued_since_us = monotonic_us();
+            job->slot = -1;
+            cpu_slots[s] = NULL;
+            preempted_slot[npreempted] = s;
+            preempted[npreempted++] = job;
+        }
+    }
+    // After charging, so a job this sample puts on a slot is not charged a slice it never ran
+    if (detect_blocked) sample_job_states();
+
+    for (int s = 0; s < NCPU; s++) {
+        runqueues[s]->ops->tick(runqueues[s], now_us);
+    }
+    if (tick_info.handled % BALANCE_TICKS == 0) {
+        balance_queues();
+    }
+    fill_free_slots();
+
+    // A preempted job the policy picked again keeps running without being signalled;
+    // fill_free_slots() already traced a move to another slot
+    for (int i = 0; i < npreempted; i++) {
+        command_info *job = preempted[i];
+        if (job->slot != -1) continue;
+        trace_record(TRACE_PREEMPT, job->sj.id, job->pid, preempted_slot[i]);
+        job->trace_slot = -1;
+        signal_job(job, SIGSTOP);
+    }
+}
+
+// Records the end of a reaped job and frees its slot
+void finish_job(command_info *job, struct rusage *usage) {
+    job->end_us = monotonic_us();
+    job->cpu_us = usage->ru_utime.tv_sec * 1000000L + usage->ru_utime.tv_usec +
+                  usage->ru_stime.tv_sec * 1000000L + usage->ru_stime.tv_usec;
+    if (job->first_run_us < 0) job->first_run_us = job->end_us; // killed before it ever ran
+    struct timeval end;
+    gettimeofday(&end, NULL);
+    job->end_time = end;
+    job->duration = (end.tv_sec - job->start_time.tv_sec) * 1000 + (end.tv_usec - job->start_time.tv_usec) / 1000;
+
+    // Whatever the job wrote before exiting is already in the pipe
+    drain_output(job);
 
-        command_history[history_count].pid = id;
-        command_history[history_count].command = strdup(command);
-        gettimeofday(&command_history[history_count].start_time, NULL);
-        command_history[history_count].duration = -1;
-        command_history[history_count].wait_time = 0;
-        ready_queue[queue_count++] = id;
-        command_history[history_count].output[0] = output_pipe[0];
-        history_count++;
+    trace_record(TRACE_EXIT, job->sj.id, job->pid, job->trace_slot);
+    job->trace_slot = -1;
+    if (job->blocked_index >= 0) blocked_remove(job);
+    if (job->slot >= 0) {
+        cpu_slots[job->slot] = NULL;
+        job->slot = -1;
     }
+    if (job->pid_fd >= 0) {
+        // Jobs still waiting to exec hold copies of the pidfd, so close() alone would leave it registered
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, job->pid_fd, NULL);
+        close(job->pid_fd);
+        job->pid_fd = -1;
+    }
+    else {
+        unwatched_jobs--;
+    }
+    active_jobs--;
+}
+
+// Reaps every exited child and hands the freed slots to queued jobs
+// The pidfd is readable, so the job is a zombie that only we can reap and its pid cannot be reused yet
+void handle_job_exit(command_info *job) {
+    int status;
+    struct rusage usage;
+    if (job->duration != -1) return; // reaped after SIGCHLD earlier in this batch
+    if (wait4(job->pid, &status, WNOHANG, &usage) != job->pid) return;
+    pid_table_take(job->pid);
+    finish_job(job, &usage);
+    fill_free_slots();
+}
+
+// Fallback for jobs without a pidfd
+void reap_children() {
+    int status;
+    pid_t pid;
+    struct rusage usage;
+    child_exited = 0;
+    if (unwatched_jobs == 0) return;
+    while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        command_info *job = pid_table_take(pid);
+        if (job == NULL) continue;
+        if (job->pid_fd < 0) sigchld_reaped++;
+        finish_job(job, &usage);
+    }
+    fill_free_slots();
+}
+
+/* Creates a periodic CLOCK_MONOTONIC timerfd. The first expiry is an
+ * absolute time, offset_us after the first slice began, and the kernel
+ * schedules later ones at start + offset + n * TSLICE, so time spent
+ * handling a tick never shifts the following ticks.
+ */
+void arm_slice_timer(int fd, struct timespec *base, long offset_us) {
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = TSLICE_US / 1000000;
+    spec.it_interval.tv_nsec = (TSLICE_US % 1000000) * 1000;
+    spec.it_value = *base;
+    spec.it_value.tv_sec += offset_us / 1000000;
+    spec.it_value.tv_nsec += (offset_us % 1000000) * 1000;
+    if (spec.it_value.tv_nsec >= 1000000000) {
+        spec.it_value.tv_sec++;
+        spec.it_value.tv_nsec -= 1000000000;
+    }
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+        perror("timerfd_settime");
+        exit(1);
+    }
+}
+
+int start_slice_timer(long offset_us) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd == -1) {
+        perror("timerfd_create");
+        exit(1);
+    }
+    arm_slice_timer(fd, &tick_info.start, offset_us);
+    return fd;
 }
-void scheduler(int signum) {
-    if (!running) return;
 
-    int executing_count = NCPU; // Number of processes to execute at once
+int start_tick_timer() {
+    clock_gettime(CLOCK_MONOTONIC, &tick_info.start);
+    tick_info.base = tick_info.start;
+    tick_info.last = tick_info.start;
+    tick_info.interval_min_us = -1;
+    return start_slice_timer(TSLICE_US);
+}
+
+// Switches to a new slice length starting at now
+void set_time_slice(long slice_us, struct timespec *now) {
+    TSLICE_US = slice_us;
+    for (int s = 0; s < NCPU; s++) {
+        policy_set_tslice(runqueues[s], slice_us);
+    }
+    arm_slice_timer(tick_fd, now, slice_us);
+    if (sample_fd != -1) arm_slice_timer(sample_fd, now, slice_us / 2);
+    tick_info.base = *now;
+    tick_info.base_ticks = tick_info.ticks;
+}
+
+void adapt_time_slice(struct timespec *now) {
+    adaptive.overhead_us = adaptive.overhead_us * 0.875 + tick_info.last_work_us * 0.125;
+    if (tick_info.handled % ADAPT_TICKS != 0) return;
 
-    // sending SIGCONT to the first NCPU processes in the queue
-    for (int i = 0; i < executing_count && i < queue_count; i++) {
-        kill(ready_queue[i], SIGCONT);
+    int queued = 0;
+    for (int s = 0; s < NCPU; s++) {
+        queued += runqueues[s]->nr_queued;
     }
+    double depth = (double)queued / NCPU;
+    long slice = depth >= 1 ? (long)(adaptive.target_latency_us / depth) : adaptive.max_us;
+    long overhead_floor = (long)(adaptive.overhead_us / MAX_OVERHEAD);
+    if (slice < overhead_floor) slice = overhead_floor;
+    if (slice < adaptive.min_us) slice = adaptive.min_us;
+    if (slice > adaptive.max_us) slice = adaptive.max_us;
+    if (labs(slice - TSLICE_US) < TSLICE_US * ADAPT_HYSTERESIS) return;
+
+    if (adaptive.nhistory == adaptive.capacity) {
+        adaptive.capacity = adaptive.capacity == 0 ? 64 : adaptive.capacity * 2;
+        adaptive.history = realloc(adaptive.history, adaptive.capacity * sizeof(slice_change));
+        if (adaptive.history == NULL) {
+            perror("Error growing slice history\n");
+            exit(1);
+        }
+    }
+    slice_change *change = &adaptive.history[adaptive.nhistory++];
+    change->at_us = timespec_diff_us(now, &tick_info.start);
+    change->slice_us = slice;
+    change->queued = queued;
+    change->overhead_us = adaptive.overhead_us;
+    set_time_slice(slice, now);
+}
 
-    // Pause the remaining processes
-    for (int i = executing_count; i < queue_count; i++) {
-        kill(ready_queue[i], SIGSTOP);
+void handle_sample(int sample_fd) {
+    uint64_t expirations;
+    if (read(sample_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+    sample_job_states();
+}
+
+// Consumes the timer expirations, records their timing and runs one tick
+void handle_tick(int timer_fd) {
+    uint64_t expirations;
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    tick_info.ticks += expirations;
+    tick_info.missed += expirations - 1;
+    double interval = timespec_diff_us(&now, &tick_info.last);
+    double lateness = timespec_diff_us(&now, &tick_info.base) - (double)(tick_info.ticks - tick_info.base_ticks) * TSLICE_US;
+    if (tick_info.handled > 0) {
+        tick_info.interval_sum_us += interval;
+        if (tick_info.interval_min_us < 0 || interval < tick_info.interval_min_us) tick_info.interval_min_us = interval;
+        if (interval > tick_info.interval_max_us) tick_info.interval_max_us = interval;
     }
+    if (lateness > tick_info.max_lateness_us) tick_info.max_lateness_us = lateness;
+    tick_info.last = now;
+    tick_info.handled++;
+
+    // Thread CPU time, so a resumed job preempting us does not count as overhead
+    struct timespec work_start, work_end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &work_start);
+    scheduler_tick(timespec_diff_us(&now, &tick_info.start));
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &work_end);
+    double work = (work_end.tv_sec - work_start.tv_sec) * 1e6 + (work_end.tv_nsec - work_start.tv_nsec) / 1e3;
+    tick_info.work_sum_us += work;
+    tick_info.last_work_us = work;
+    if (work > tick_info.work_max_us) tick_info.work_max_us = work;
+
+    if (adaptive.enabled) adapt_time_slice(&now);
+}
 
-    usleep(TSLICE * 1000);  // Time slice wait
-    if (running) {
-        alarm(TSLICE / 1000);  // Trigger the next scheduling interval
+// Slice changes over time, with the time-weighted mean slice
+void display_slice_history(long end_us) {
+    printf("Adaptive slice: %.1f-%.1f ms, target latency %.1f ms, %d changes",
+           adaptive.min_us / 1000.0, adaptive.max_us / 1000.0, adaptive.target_latency_us / 1000.0, adaptive.nhistory);
+    double weighted = 0;
+    long from_us = 0, slice_us = adaptive.initial_us;
+    for (int i = 0; i < adaptive.nhistory; i++) {
+        weighted += (double)slice_us * (adaptive.history[i].at_us - from_us);
+        from_us = adaptive.history[i].at_us;
+        slice_us = adaptive.history[i].slice_us;
+    }
+    weighted += (double)slice_us * (end_us - from_us);
+    if (end_us > 0) printf(", time-weighted mean %.2f ms", weighted / end_us / 1000.0);
+    if (tick_info.signals > 0) printf(", %.2f us per SIGSTOP/SIGCONT", adaptive.signal_sum_us / tick_info.signals);
+    printf("\n  %10s %10s %8s %12s\n", "at (ms)", "slice (ms)", "queued", "overhead (us)");
+    printf("  %10.1f %10.2f %8s %12s\n", 0.0, adaptive.initial_us / 1000.0, "-", "-");
+    for (int i = 0; i < adaptive.nhistory && i < SLICE_HISTORY_SHOWN; i++) {
+        slice_change *change = &adaptive.history[i];
+        printf("  %10.1f %10.2f %8d %12.2f\n", change->at_us / 1000.0, change->slice_us / 1000.0,
+               change->queued, change->overhead_us);
+    }
+    if (adaptive.nhistory > SLICE_HISTORY_SHOWN) {
+        printf("  ... %d more changes\n", adaptive.nhistory - SLICE_HISTORY_SHOWN);
     }
 }
 
+void display_tick_info() {
+    printf("\nTime slice: requested %ld us", adaptive.enabled ? adaptive.initial_us : TSLICE_US);
+    if (tick_info.handled > 1) {
+        printf(", measured mean %.1f us (min %.1f, max %.1f)",
+               tick_info.interval_sum_us / (tick_info.handled - 1), tick_info.interval_min_us, tick_info.interval_max_us);
+    }
+    printf("\nTicks: %ld, missed: %ld, worst lateness: %.1f us\n",
+           tick_info.ticks, tick_info.missed, tick_info.max_lateness_us);
+    if (tick_info.handled > 0) {
+        printf("Scheduling overhead per tick: mean %.2f us, max %.1f us, %.2f signals (%ld jobs, %ld signals total)\n",
+               tick_info.work_sum_us / tick_info.handled, tick_info.work_max_us,
+               (double)tick_info.signals / tick_info.handled, (long)history_count, tick_info.signals);
+    }
+}
+
+// Wait, response, turnaround and CPU time across all jobs, in ms
+void display_job_stats() {
+    int n = history_count;
+    if (n == 0) return;
+    long *wait = malloc(5 * n * sizeof(long));
+    long *response = wait + n, *turnaround = wait + 2 * n, *cpu = wait + 3 * n, *launch = wait + 4 * n;
+    long slices = 0;
+    int launched = 0;
+    for (int i = 0; i < n; i++) {
+        command_info *job = command_history[i];
+        wait[i] = job->wait_us;
+        response[i] = job->first_run_us - job->submit_us;
+        turnaround[i] = job->end_us - job->submit_us;
+        cpu[i] = job->cpu_us;
+        slices += job->slices;
+        if (job->exec_us >= 0) launch[launched++] = job->exec_us - job->first_run_us;
+    }
+    printf("\n%d jobs, %ld slices\n", n, slices);
+    print_stats_header(stdout);
+    print_stats_row(stdout, "Wait", summarize_us(wait, n));
+    print_stats_row(stdout, "Response", summarize_us(response, n));
+    print_stats_row(stdout, "Turnaround", summarize_us(turnaround, n));
+    print_stats_row(stdout, "CPU time", summarize_us(cpu, n));
+    if (launched > 0) print_stats_row(stdout, "Launch", summarize_us(launch, launched));
+    free(wait);
+}
+
+// Per-job accounting for scripts; times in ms, submit relative to the first job
+void write_jobs_csv(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(out, "pid,priority,submit_ms,wait_ms,response_ms,turnaround_ms,cpu_ms,slices,command\n");
+    long base_us = history_count > 0 ? command_history[0]->submit_us : 0;
+    for (int i = 0; i < history_count; i++) {
+        command_info *job = command_history[i];
+        fprintf(out, "%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%d,\"", job->pid, job->sj.priority,
+                (job->submit_us - base_us) / 1000.0, job->wait_us / 1000.0,
+                (job->first_run_us - job->submit_us) / 1000.0, (job->end_us - job->submit_us) / 1000.0,
+                job->cpu_us / 1000.0, job->slices);
+        for (char *c = job->command; *c != '\0'; c++) {
+            if (*c == '"') fputc('"', out); // CSV doubles embedded quotes
+            fputc(*c, out);
+        }
+        fprintf(out, "\"\n");
+    }
+    fclose(out);
+}
+
+void display_cpu_info() {
+    printf("Run queues: %d, pinned to cores", NCPU);
+    for (int s = 0; s < NCPU; s++) {
+        printf("%s%d", s == 0 ? " " : ",", slot_cores[s]);
+    }
+    printf("; %ld steals, %ld migrations\n", steals, migrations);
+    if (detect_blocked) {
+        printf("Blocked jobs: %ld slots released early, %ld wakeups requeued\n", block_releases, block_wakeups);
+    }
+    int gangs = 0, largest = 1;
+    for (int i = 0; i < history_count; i++) {
+        if (command_history[i]->processes > 1) gangs++;
+        if (command_history[i]->processes > largest) largest = command_history[i]->processes;
+    }
+    if (sigchld_reaped > 0) printf("Exits: %ld jobs had no pidfd and were reaped after SIGCHLD\n", sigchld_reaped);
+    if (gangs > 0) printf("Process groups: %d jobs forked, up to %d processes each\n", gangs, largest);
+}
+
+// Per shares class, the slices its tickets entitled it to against the slices it got
+void display_share_info() {
+    int classes[history_count], nclasses = 0;
+    double total_entitled = 0;
+    long total_slices = 0;
+    for (int i = 0; i < history_count; i++) {
+        command_info *job = command_history[i];
+        total_entitled += job->entitled_slices;
+        total_slices += job->slices;
+        int c = 0;
+        while (c < nclasses && classes[c] != job->sj.tickets) c++;
+        if (c == nclasses) classes[nclasses++] = job->sj.tickets;
+    }
+    if (total_slices == 0) return;
+    printf("CPU shares:\n  %8s %6s %10s %10s\n", "shares", "jobs", "requested", "achieved");
+    for (int c = 0; c < nclasses; c++) {
+        double entitled = 0;
+        long slices = 0;
+        int jobs = 0;
+        for (int i = 0; i < history_count; i++) {
+            if (command_history[i]->sj.tickets != classes[c]) continue;
+            entitled += command_history[i]->entitled_slices;
+            slices += command_history[i]->slices;
+            jobs++;
+        }
+        printf("  %8d %6d %9.1f%% %9.1f%%\n", classes[c], jobs, 100.0 * entitled / total_entitled,
+               100.0 * slices / total_slices);
+    }
+}
+
+const char *job_name(int job) {
+    return command_history[job]->command;
+}
+
 // Function to wait for all processes to terminate
 void wait_for_all_processes() {
     for (int i = 0; i < history_count; i++) {
-        if (command_history[i].duration == -1) {
-            waitpid(command_history[i].pid, NULL, 0);
-            struct timeval end;
-            gettimeofday(&end, NULL);
-            command_history[i].end_time = end;
-            command_history[i].duration = (end.tv_sec - command_history[i].start_time.tv_sec) * 1000 + (end.tv_usec - command_history[i].start_time.tv_usec) / 1000;
-
-            // Read output from the pipe for any remaining data
-            char buffer[OUTPUT_SIZE];
-            int n = read(command_history[i].output[0], buffer, OUTPUT_SIZE - 1);
-            if (n > 0) {
-                buffer[n] = '\0';
-                strncat(command_history[i].output, buffer, OUTPUT_SIZE - strlen(command_history[i].output) - 1);
-            }
-            close(command_history[i].output[0]);
+        if (command_history[i]->duration == -1) {
+            struct rusage usage;
+            wait4(command_history[i]->pid, NULL, 0, &usage);
+            pid_table_take(command_history[i]->pid);
+            finish_job(command_history[i], &usage);
+        }
+    }
+}
+
+/*
+ * Metrics socket. The listening socket sits in the event loop like any
+ * other source; each connection is accepted, sent one snapshot in the
+ * Prometheus text format and closed. Nothing waits on the client: the
+ * snapshot goes out with a single non-blocking send and is dropped if the
+ * socket buffer cannot take it, so a stuck reader never delays a tick.
+ * Read it with e.g. socat - UNIX-CONNECT:PATH
+ */
+
+int open_metrics_socket(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: metrics socket path %s is too long\n", path);
+        exit(1);
+    }
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("Error creating metrics socket");
+        exit(1);
+    }
+    // A socket left behind by an earlier run is replaced; anything else is kept
+    struct stat existing;
+    if (lstat(path, &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            fprintf(stderr, "Error: %s exists and is not a socket\n", path);
+            exit(1);
+        }
+        unlink(path);
+    }
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        perror(path);
+        exit(1);
+    }
+    return fd;
+}
+
+static void metric_header(FILE *out, const char *name, const char *type, const char *help) {
+    fprintf(out, "# HELP simplescheduler_%s %s\n# TYPE simplescheduler_%s %s\n", name, help, name, type);
+}
+
+void write_metrics(FILE *out) {
+    metric_header(out, "ticks_total", "counter", "Timer expirations since startup, including missed ones.");
+    fprintf(out, "simplescheduler_ticks_total %ld\n", tick_info.ticks);
+    metric_header(out, "ticks_missed_total", "counter", "Timer expirations that passed while the loop was busy.");
+    fprintf(out, "simplescheduler_ticks_missed_total %ld\n", tick_info.missed);
+    metric_header(out, "time_slice_seconds", "gauge", "Current time slice.");
+    fprintf(out, "simplescheduler_time_slice_seconds %g\n", TSLICE_US / 1e6);
+
+    int depth[MAX_PRIORITY + 1] = {0};
+    for (int i = 0; i < history_count; i++) {
+        command_info *job = command_history[i];
+        // Queued: live, pinned to a queue by enqueue_job(), and neither running nor blocked
+        if (job->duration == -1 && job->cpu >= 0 && job->slot == -1 && job->blocked_index == -1) {
+            depth[job->sj.priority]++;
+        }
+    }
+    metric_header(out, "queue_depth", "gauge", "Jobs waiting in a run queue, by priority.");
+    for (int p = MIN_PRIORITY; p <= MAX_PRIORITY; p++) {
+        fprintf(out, "simplescheduler_queue_depth{priority=\"%d\"} %d\n", p, depth[p]);
+    }
+    metric_header(out, "runqueue_length", "gauge", "Jobs queued on each CPU slot's run queue.");
+    for (int s = 0; s < NCPU; s++) {
+        fprintf(out, "simplescheduler_runqueue_length{slot=\"%d\"} %d\n", s, runqueues[s]->nr_queued);
+    }
+    metric_header(out, "slot_busy", "gauge", "Whether a job holds the CPU slot.");
+    for (int s = 0; s < NCPU; s++) {
+        fprintf(out, "simplescheduler_slot_busy{slot=\"%d\",core=\"%d\"} %d\n", s, slot_cores[s], cpu_slots[s] != NULL);
+    }
+    metric_header(out, "slot_job", "gauge", "The job running on each busy CPU slot.");
+    for (int s = 0; s < NCPU; s++) {
+        if (cpu_slots[s] == NULL) continue;
+        fprintf(out, "simplescheduler_slot_job{slot=\"%d\",job=\"%d\",pid=\"%d\",priority=\"%d\"} 1\n", s,
+                cpu_slots[s]->sj.id, cpu_slots[s]->pid, cpu_slots[s]->sj.priority);
+    }
+    metric_header(out, "active_jobs", "gauge", "Submitted jobs that have not exited.");
+    fprintf(out, "simplescheduler_active_jobs %d\n", active_jobs);
+    metric_header(out, "blocked_jobs", "gauge", "Jobs that gave up their slot while waiting in the kernel.");
+    fprintf(out, "simplescheduler_blocked_jobs %d\n", nblocked);
+    metric_header(out, "pending_arrivals", "gauge", "Batch jobs launched but not yet released.");
+    fprintf(out, "simplescheduler_pending_arrivals %d\n", narrivals - next_arrival);
+
+    metric_header(out, "dispatch_latency_seconds", "histogram", "Time from entering a run queue to getting a slot.");
+    long cumulative = 0;
+    for (int b = 0; b < DISPATCH_BUCKETS; b++) {
+        cumulative += metrics.dispatch_buckets[b];
+        fprintf(out, "simplescheduler_dispatch_latency_seconds_bucket{le=\"%g\"} %ld\n",
+                dispatch_bounds_us[b] / 1e6, cumulative);
+    }
+    fprintf(out, "simplescheduler_dispatch_latency_seconds_bucket{le=\"+Inf\"} %ld\n", metrics.dispatches);
+    fprintf(out, "simplescheduler_dispatch_latency_seconds_sum %g\n", metrics.dispatch_sum_us / 1e6);
+    fprintf(out, "simplescheduler_dispatch_latency_seconds_count %ld\n", metrics.dispatches);
+
+    metric_header(out, "signals_total", "counter", "Stop and continue signals sent to job process groups.");
+    fprintf(out, "simplescheduler_signals_total{signal=\"SIGSTOP\"} %ld\n", metrics.stops);
+    fprintf(out, "simplescheduler_signals_total{signal=\"SIGCONT\"} %ld\n", metrics.conts);
+    metric_header(out, "signal_seconds_total", "counter", "Time spent inside the killpg() calls.");
+    fprintf(out, "simplescheduler_signal_seconds_total %g\n", adaptive.signal_sum_us / 1e6);
+}
+
+// Serves every pending connection; never blocks on a slow or silent client
+void handle_metrics(int listen_fd) {
+    int client;
+    while ((client = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        char *snapshot = NULL;
+        size_t length = 0;
+        FILE *out = open_memstream(&snapshot, &length);
+        if (out != NULL) {
+            write_metrics(out);
+            fclose(out);
+            send(client, snapshot, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+            free(snapshot);
+        }
+        close(client);
+    }
+}
+
+void print_prompt() {
+    printf("SimpleShell:~$ ");
+    fflush(stdout);
+}
+
+void run_user_command(char *user_input) {
+    if (strcmp(user_input, "history") == 0) {
+        for (int i = 0; i < history_count; i++) {
+            printf("%d: %s\n", i + 1, command_history[i]->command);
+        }
+    }
+    else if (strncmp(user_input, "submit ", 7) == 0) {
+        char *command = user_input + 7;
+        int shares = policy_parse_shares(&command);
+        if (shares < 0) {
+            printf("Error: --shares needs a number from 1 to %d\n", MAX_SHARES);
+            return;
+        }
+        int priority = policy_parse_priority(command);
+        enqueue_job(execute_command(command, priority, shares));
+        fill_free_slots(); // an idle slot takes the job now instead of at the next tick
+    }
+    else if (strncmp(user_input, "submit-batch ", 13) == 0) {
+        submit_batch(user_input + 13);
+    }
+}
+
+// Reads whatever stdin has and runs each complete line; returns false at end of input
+bool handle_input() {
+    static char line[BUFFER_SIZE];
+    static int line_length = 0;
+    char buffer[BUFFER_SIZE];
+
+    int n = read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (n < 0) return errno == EINTR || errno == EAGAIN;
+    if (n == 0) return false;
+    for (int i = 0; i < n; i++) {
+        if (buffer[i] == '\n') {
+            line[line_length] = '\0';
+            run_user_command(line);
+            line_length = 0;
+            print_prompt();
+        }
+        else if (line_length < BUFFER_SIZE - 1) {
+            line[line_length++] = buffer[i];
         }
     }
+    return true;
+}
+
+// Every job holds a pipe until it is reaped, so allow as many descriptors as the hard limit
+void raise_fd_limit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur / 4 < MAX_PIDFDS) {
+        pidfd_budget = limit.rlim_cur / 4;
+    }
+}
+
+void usage(char *program) {
+    fprintf(stderr, "Usage: %s <NCPU> <TSLICE(ms)> [options]\n", program);
+    policy_usage(stderr);
+    fprintf(stderr, "  --trace FILE           write a Chrome trace of scheduling events to FILE at exit\n");
+    fprintf(stderr, "  --trace-events N       trace ring size in events (default %d)\n", DEFAULT_TRACE_EVENTS);
+    fprintf(stderr, "  --jobs-csv FILE        write one line of accounting per job to FILE at exit\n");
+    fprintf(stderr, "  --no-block-detect      let jobs blocked on I/O or sleep keep their slot\n");
+    fprintf(stderr, "  --adaptive             adjust TSLICE at runtime to hold the target latency\n");
+    fprintf(stderr, "  --slice-min ms         adaptive lower bound (default %d)\n", DEFAULT_SLICE_MIN_US / 1000);
+    fprintf(stderr, "  --slice-max ms         adaptive upper bound (default %d)\n", DEFAULT_SLICE_MAX_US / 1000);
+    fprintf(stderr, "  --batch file           run a submit-batch manifest, then exit once its jobs finish\n");
+    fprintf(stderr, "  --metrics-socket PATH  serve Prometheus text metrics on a Unix socket\n");
+    fprintf(stderr, "  --target-latency ms    adaptive wait for a queued job's turn (default %d)\n",
+            DEFAULT_TARGET_LATENCY_US / 1000);
+    exit(1);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <NCPU> <TSLICE>\n", argv[0]);
+    static struct option long_options[] = {
+        POLICY_LONG_OPTIONS,
+        {"trace", required_argument, NULL, OPT_TRACE},
+        {"trace-events", required_argument, NULL, OPT_TRACE_EVENTS},
+        {"jobs-csv", required_argument, NULL, OPT_JOBS_CSV},
+        {"no-block-detect", no_argument, NULL, OPT_NO_BLOCK_DETECT},
+        {"adaptive", no_argument, NULL, OPT_ADAPTIVE},
+        {"slice-min", required_argument, NULL, OPT_SLICE_MIN},
+        {"slice-max", required_argument, NULL, OPT_SLICE_MAX},
+        {"target-latency", required_argument, NULL, OPT_TARGET_LATENCY},
+        {"batch", required_argument, NULL, OPT_BATCH},
+        {"metrics-socket", required_argument, NULL, OPT_METRICS_SOCKET},
+        {NULL, 0, NULL, 0},
+    };
+    policy_config config;
+    policy_config_init(&config);
+    adaptive.min_us = DEFAULT_SLICE_MIN_US;
+    adaptive.max_us = DEFAULT_SLICE_MAX_US;
+    adaptive.target_latency_us = DEFAULT_TARGET_LATENCY_US;
+    const char *trace_path = NULL;
+    const char *jobs_csv_path = NULL;
+    const char *batch_path = NULL;
+    const char *metrics_path = NULL;
+    long trace_events = DEFAULT_TRACE_EVENTS;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        if (opt == OPT_TRACE) {
+            trace_path = optarg;
+        }
+        else if (opt == OPT_BATCH) {
+            batch_path = optarg;
+        }
+        else if (opt == OPT_METRICS_SOCKET) {
+            metrics_path = optarg;
+        }
+        else if (opt == OPT_ADAPTIVE) {
+            adaptive.enabled = true;
+        }
+        else if (opt == OPT_SLICE_MIN || opt == OPT_SLICE_MAX || opt == OPT_TARGET_LATENCY) {
+            long value_us = (long)(strtod(optarg, NULL) * 1000 + 0.5);
+            if (value_us < MIN_TSLICE_US) usage(argv[0]);
+            if (opt == OPT_SLICE_MIN) adaptive.min_us = value_us;
+            else if (opt == OPT_SLICE_MAX) adaptive.max_us = value_us;
+            else adaptive.target_latency_us = value_us;
+        }
+        else if (opt == OPT_NO_BLOCK_DETECT) {
+            detect_blocked = false;
+        }
+        else if (opt == OPT_JOBS_CSV) {
+            jobs_csv_path = optarg;
+        }
+        else if (opt == OPT_TRACE_EVENTS) {
+            trace_events = atol(optarg);
+            if (trace_events <= 0) usage(argv[0]);
+        }
+        else if (opt == '?' || !policy_config_option(&config, opt, optarg)) {
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind != 2) usage(argv[0]);
+
+    NCPU = atoi(argv[optind]);
+    TSLICE_US = (long)(strtod(argv[optind + 1], NULL) * 1000 + 0.5); // fractional ms allowed, e.g. 0.1
+    if (NCPU <= 0 || TSLICE_US < MIN_TSLICE_US) {
+        fprintf(stderr, "Error: NCPU must be positive and TSLICE at least %d us\n", MIN_TSLICE_US);
         exit(1);
     }
-    NCPU = atoi(argv[1]);
-    TSLICE = atoi(argv[2]);
+    if (adaptive.enabled) {
+        if (adaptive.min_us > adaptive.max_us) {
+            fprintf(stderr, "Error: --slice-min is larger than --slice-max\n");
+            exit(1);
+        }
+        // Start inside the bounds, the controller takes over from there
+        if (TSLICE_US < adaptive.min_us) TSLICE_US = adaptive.min_us;
+        if (TSLICE_US > adaptive.max_us) TSLICE_US = adaptive.max_us;
+        adaptive.initial_us = TSLICE_US;
+    }
+    runqueues = malloc(NCPU * sizeof(sched_policy *));
+    for (int s = 0; s < NCPU; s++) {
+        runqueues[s] = policy_create(&config, TSLICE_US);
+        if (runqueues[s] == NULL) {
+            fprintf(stderr, "Error: unknown policy %s\n", config.name);
+            usage(argv[0]);
+        }
+    }
+    share_accounting = strcmp(runqueues[0]->ops->name, "stride") == 0;
+    measure_runtime = strcmp(runqueues[0]->ops->name, "fair") == 0;
+    cpu_slots = calloc(NCPU, sizeof(command_info *));
+    assign_slot_cores();
+    if (trace_path != NULL) trace_init(trace_events);
+    raise_fd_limit();
 
     signal(SIGINT, sigint_handler); // Handle Ctrl+C
-    signal(SIGALRM, scheduler); // Handle alarms for scheduling
-    signal(SIGCHLD, sigchld_handler); // Handle child process termination
+    // Only needed for jobs without a pidfd; SA_NOCLDSTOP keeps our own SIGSTOPs from interrupting epoll_wait
+    struct sigaction chld;
+    memset(&chld, 0, sizeof(chld));
+    chld.sa_handler = sigchld_handler;
+    chld.sa_flags = SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &chld, NULL);
 
     system("clear");
-    alarm(TSLICE / 1000); // Start the scheduler
-
-    while (running) {
-        printf("SimpleShell:~$ ");
-        char user_input[BUFFER_SIZE];
-        if (fgets(user_input, BUFFER_SIZE, stdin) == NULL) break;
-        int user_input_length = strlen(user_input);
-        if (user_input[user_input_length - 1] == '\n') {
-            user_input[user_input_length - 1] = '\0';
-        }
-        if (strcmp(user_input, "history") == 0) {
-            for (int i = 0; i < history_count; i++) {
-                printf("%d: %s\n", i + 1, command_history[i].command);
-            }
-            continue;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        perror("epoll_create1");
+        exit(1);
+    }
+    tick_fd = start_tick_timer(); // Start the scheduler
+    add_event_source(tick_fd, EV_TICK);
+    if (detect_blocked) {
+        sample_fd = start_slice_timer(TSLICE_US / 2);
+        add_event_source(sample_fd, EV_SAMPLE);
+    }
+    int metrics_fd = -1;
+    if (metrics_path != NULL) {
+        metrics_fd = open_metrics_socket(metrics_path);
+        add_event_source(metrics_fd, EV_METRICS);
+    }
+    if (batch_path != NULL) {
+        // Non-interactive: run the manifest to completion without reading commands
+        submit_batch(batch_path);
+        running = false;
+    }
+    else {
+        print_prompt();
+        if (!add_event_source(STDIN_FILENO, EV_STDIN)) {
+            // Input redirected from a file never blocks, so take all of it now
+            while (handle_input());
+            running = false;
         }
-        else if (strncmp(user_input, "submit ", 7) == 0) {
-            execute_command(user_input + 7);
+    }
+
+    // Keep scheduling after input stops until every submitted job has finished
+    bool reading_input = running;
+    while (running || active_jobs > 0) {
+        if (!running && reading_input) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+            reading_input = false;
+        }
+        struct epoll_event events[MAX_EVENTS];
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n == -1 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        if (child_exited) reap_children();
+        if (n == -1) continue;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u32 == EV_TICK) {
+                handle_tick(tick_fd);
+            }
+            else if (events[i].data.u32 == EV_SAMPLE) {
+                handle_sample(sample_fd);
+            }
+            else if (events[i].data.u32 == EV_METRICS) {
+                handle_metrics(metrics_fd);
+            }
+            else if (events[i].data.u32 == EV_STDIN) {
+                if (running && !handle_input()) running = false;
+            }
+            else if (events[i].data.u32 & EV_JOB_EXIT) {
+                handle_job_exit(command_history[events[i].data.u32 & ~EV_JOB_EXIT]);
+            }
+            else {
+                drain_output(command_history[events[i].data.u32 - EV_JOB_OUTPUT]);
+            }
         }
     }
 
     wait_for_all_processes();
+    close(tick_fd);
+    if (sample_fd != -1) close(sample_fd);
+    if (metrics_fd != -1) {
+        close(metrics_fd);
+        unlink(metrics_path);
+    }
+    close(epoll_fd);
 
     if (ctrl_c_flag) {
         display_command_info();
     }
+    policy_describe(runqueues[0], stdout);
+    display_job_stats();
+    display_cpu_info();
+    if (share_accounting) display_share_info();
+    display_tick_info();
+    if (adaptive.enabled) display_slice_history(timespec_diff_us(&tick_info.last, &tick_info.start));
+    if (trace_path != NULL) trace_export(trace_path, NCPU, job_name);
+    if (jobs_csv_path != NULL) write_jobs_csv(jobs_csv_path);
+    for (int s = 0; s < NCPU; s++) {
+        policy_destroy(runqueues[s]);
+    }
+    free(runqueues);
 
     return 0;
 }
-
@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include "policy.h"
+#include "stats.h"
+
+/*
+ * Offline SimpleScheduler: runs the real policy code against a workload file
+ * in virtual time, so a policy or NCPU/TSLICE change can be evaluated over
+ * thousands of configurations in seconds instead of by running jobs.
+ *
+ * The model follows scheduler.c: the clock ticks every TSLICE, each running
+ * job is charged a full slice per tick, a job is preempted only when its
+ * quantum is used up and something is queued (or the policy preempts it),
+ * and free slots are filled at every tick and whenever a job exits. Jobs
+ * that arrive between ticks wait for the next one. A job doing I/O gives
+ * up its slot until the I/O ends, as with the scheduler's block detection,
+ * unless --keep-slot-on-block is given. Unlike scheduler.c, all slots share
+ * one run queue, so stealing and load balancing are not modelled.
+ */
+
+#define MAX_SWEEP 4096 // values per swept parameter
+
+typedef struct {
+    // Workload
+    long arrival_us;
+    long cpu_us;      // total CPU burst
+    long io_every_us; // CPU time between I/O waits, 0 for none
+    long io_us;       // length of each I/O wait
+    int priority;
+
+    // Simulation state, reset for every configuration
+    long cpu_left_us;
+    long until_io_us;
+    long io_end_us;   // end of the current I/O wait, -1 when not waiting
+    int slot;         // -1 when not on a CPU slot
+    bool on_cpu;      // resumed and not stopped since, as in scheduler.c
+    long queued_since_us;
+    long wait_us;
+    long first_run_us;
+    long finish_us;
+    sched_job sj;
+} sim_job;
+
+typedef struct {
+    int ncpu;
+    long tslice_us;
+    long makespan_us;
+    long dispatches; // SIGCONTs the real scheduler would send
+    time_stats wait;
+    time_stats response;
+    time_stats turnaround;
+} sim_result;
+
+sim_job *jobs;
+int njobs = 0;
+bool release_on_block = true;
+
+int compare_arrival(const void *a, const void *b) {
+    const sim_job *x = a, *y = b;
+    return (x->arrival_us > y->arrival_us) - (x->arrival_us < y->arrival_us);
+}
+
+/*
+ * One job per line: arrival_ms cpu_ms [io_every_ms io_ms [priority]]
+ * Blank lines and lines starting with # are ignored.
+ */
+void load_workload(const char *path) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        exit(1);
+    }
+    int capacity = 0;
+    char line[256];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        lineno++;
+        double arrival, cpu, io_every = 0, io = 0;
+        int priority = MIN_PRIORITY;
+        char *start = line + strspn(line, " \t");
+        if (*start == '#' || *start == '\n' || *start == '\0') continue;
+        int fields = sscanf(start, "%lf %lf %lf %lf %d", &arrival, &cpu, &io_every, &io, &priority);
+        if (fields < 2 || fields == 3 || arrival < 0 || cpu < 0 || io_every < 0 || io < 0 ||
+            priority < MIN_PRIORITY || priority > MAX_PRIORITY) {
+            fprintf(stderr, "%s:%d: expected arrival_ms cpu_ms [io_every_ms io_ms [priority]]\n", path, lineno);
+            exit(1);
+        }
+        if (njobs == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            jobs = realloc(jobs, capacity * sizeof(sim_job));
+            if (jobs == NULL) {
+                perror("workload");
+                exit(1);
+            }
+        }
+        sim_job *job = &jobs[njobs++];
+        memset(job, 0, sizeof(*job));
+        job->arrival_us = (long)(arrival * 1000 + 0.5);
+        job->cpu_us = (long)(cpu * 1000 + 0.5);
+        job->io_every_us = (long)(io_every * 1000 + 0.5);
+        job->io_us = (long)(io * 1000 + 0.5);
+        job->priority = priority;
+    }
+    fclose(in);
+    if (njobs == 0) {
+        fprintf(stderr, "%s: no jobs\n", path);
+        exit(1);
+    }
+    qsort(jobs, njobs, sizeof(sim_job), compare_arrival);
+}
+
+bool in_io(sim_job *job) {
+    return job->io_end_us >= 0;
+}
+
+typedef struct {
+    sched_policy *policy;
+    sim_job **slots;
+    int ncpu;
+    sim_job **waiting; // jobs in an I/O wait
+    int nwaiting;
+    long dispatches;
+    int done;
+} sim_state;
+
+void sim_enqueue(sim_state *sim, sim_job *job, long now) {
+    job->queued_since_us = now;
+    sim->policy->ops->enqueue(sim->policy, &job->sj);
+}
+
+void sim_fill(sim_state *sim, long now) {
+    for (int s = 0; s < sim->ncpu; s++) {
+        if (sim->slots[s] != NULL) continue;
+        sched_job *next = sim->policy->ops->pick_next(sim->policy);
+        if (next == NULL) return;
+        sim_job *job = &jobs[next->id];
+        job->wait_us += now - job->queued_since_us;
+        if (job->first_run_us < 0) job->first_run_us = now;
+        job->slot = s;
+        sim->slots[s] = job;
+        if (!job->on_cpu) {
+            job->on_cpu = true;
+            sim->dispatches++;
+        }
+    }
+}
+
+// Same charging and preemption as scheduler_tick() in scheduler.c, on a single shared queue
+void sim_tick(sim_state *sim, long now, long tslice_us) {
+    sched_policy *policy = sim->policy;
+    sim_job *preempted[sim->ncpu];
+    int npreempted = 0;
+    for (int s = 0; s < sim->ncpu; s++) {
+        sim_job *job = sim->slots[s];
+        if (job == NULL) continue;
+        job->sj.slice_used_us += tslice_us;
+        job->sj.runtime_us += tslice_us; // a simulated job uses its whole slot
+        bool expired = job->sj.slice_used_us >= policy->ops->quantum_us(policy, &job->sj);
+        if (expired) {
+            policy->ops->expired(policy, &job->sj);
+            job->sj.slice_used_us = 0;
+        }
+        if ((expired && policy->nr_queued > 0) || policy->ops->preempts(policy, &job->sj)) {
+            sim_enqueue(sim, job, now);
+            job->slot = -1;
+            sim->slots[s] = NULL;
+            preempted[npreempted++] = job;
+        }
+    }
+    policy->ops->tick(policy, now);
+    sim_fill(sim, now);
+    // A preempted job picked straight back up keeps running
+    for (int i = 0; i < npreempted; i++) {
+        if (preempted[i]->slot < 0) preempted[i]->on_cpu = false;
+    }
+}
+
+sim_result simulate(const policy_config *config, int ncpu, long tslice_us) {
+    sim_state sim;
+    sim.policy = policy_create(config, tslice_us);
+    sim.slots = calloc(ncpu, sizeof(sim_job *));
+    sim.ncpu = ncpu;
+    sim.waiting = malloc(njobs * sizeof(sim_job *));
+    sim.nwaiting = 0;
+    sim.dispatches = 0;
+    sim.done = 0;
+    for (int i = 0; i < njobs; i++) {
+        sim_job *job = &jobs[i];
+        job->cpu_left_us = job->cpu_us;
+        job->until_io_us = job->io_every_us;
+        job->io_end_us = -1;
+        job->slot = -1;
+        job->on_cpu = false;
+        job->wait_us = 0;
+        job->first_run_us = -1;
+        job->finish_us = -1;
+        sched_job_init(&job->sj, i, job->priority);
+    }
+
+    long now = 0;
+    long next_tick = tslice_us;
+    int next_arrival = 0;
+    while (sim.done < njobs) {
+        // Next event: a tick, an arrival, a running job finishing or
+        // starting I/O, or any job's I/O completing
+        long t = next_tick;
+        if (next_arrival < njobs && jobs[next_arrival].arrival_us < t) t = jobs[next_arrival].arrival_us;
+        for (int s = 0; s < ncpu; s++) {
+            sim_job *job = sim.slots[s];
+            if (job == NULL || in_io(job)) continue;
+            long run = job->cpu_left_us;
+            if (job->io_every_us > 0 && job->until_io_us < run) run = job->until_io_us;
+            if (now + run < t) t = now + run;
+        }
+        for (int i = 0; i < sim.nwaiting; i++) {
+            if (sim.waiting[i]->io_end_us < t) t = sim.waiting[i]->io_end_us;
+        }
+
+        // Run the CPU-phase jobs up to t
+        for (int s = 0; s < ncpu; s++) {
+            sim_job *job = sim.slots[s];
+            if (job == NULL || in_io(job)) continue;
+            job->cpu_left_us -= t - now;
+            job->until_io_us -= t - now;
+        }
+        now = t;
+
+        bool freed = false;
+        for (int i = 0; i < sim.nwaiting; i++) {
+            sim_job *job = sim.waiting[i];
+            if (job->io_end_us > now) continue;
+            job->io_end_us = -1;
+            sim.waiting[i--] = sim.waiting[--sim.nwaiting];
+            if (release_on_block) sim_enqueue(&sim, job, now); // woken up, runnable again
+        }
+        for (int s = 0; s < ncpu; s++) {
+            sim_job *job = sim.slots[s];
+            if (job == NULL || in_io(job)) continue;
+            if (job->cpu_left_us <= 0) {
+                job->finish_us = now;
+                job->slot = -1;
+                sim.slots[s] = NULL;
+                sim.done++;
+                freed = true;
+            }
+            else if (job->io_every_us > 0 && job->until_io_us <= 0) {
+                job->io_end_us = now + job->io_us;
+                job->until_io_us = job->io_every_us;
+                sim.waiting[sim.nwaiting++] = job;
+                if (release_on_block) {
+                    job->slot = -1;
+                    job->on_cpu = false;
+                    sim.slots[s] = NULL;
+                    freed = true;
+                }
+            }
+        }
+        while (next_arrival < njobs && jobs[next_arrival].arrival_us <= now) {
+            sim_enqueue(&sim, &jobs[next_arrival], now);
+            next_arrival++;
+        }
+
+        if (now == next_tick) {
+            sim_tick(&sim, now, tslice_us);
+            next_tick += tslice_us;
+        }
+        else if (freed) {
+            sim_fill(&sim, now);
+        }
+    }
+
+    sim_result result;
+    result.ncpu = ncpu;
+    result.tslice_us = tslice_us;
+    result.makespan_us = now - jobs[0].arrival_us;
+    result.dispatches = sim.dispatches;
+    long *values = malloc(njobs * sizeof(long));
+    for (int i = 0; i < njobs; i++) values[i] = jobs[i].wait_us;
+    result.wait = summarize_us(values, njobs);
+    for (int i = 0; i < njobs; i++) values[i] = jobs[i].first_run_us - jobs[i].arrival_us;
+    result.response = summarize_us(values, njobs);
+    for (int i = 0; i < njobs; i++) values[i] = jobs[i].finish_us - jobs[i].arrival_us;
+    result.turnaround = summarize_us(values, njobs);
+    free(values);
+    free(sim.waiting);
+    free(sim.slots);
+    policy_destroy(sim.policy);
+    return result;
+}
+
+/*
+ * Comma separated values or ranges: "1,2,4" or "1:8" or "0.5:20:0.5".
+ * A range without a step counts up by one.
+ */
+int parse_sweep(const char *arg, double *values) {
+    int n = 0;
+    char *end;
+    while (*arg != '\0') {
+        double first = strtod(arg, &end), last = first, step = 1;
+        if (end == arg) return 0;
+        if (*end == ':') {
+            arg = end + 1;
+            last = strtod(arg, &end);
+            if (end == arg) return 0;
+            if (*end == ':') {
+                arg = end + 1;
+                step = strtod(arg, &end);
+                if (end == arg || step <= 0) return 0;
+            }
+        }
+        for (double v = first; v <= last + step / 1e6 && n < MAX_SWEEP; v += step) {
+            values[n++] = v;
+        }
+        if (*end == ',') end++;
+        else if (*end != '\0') return 0;
+        arg = end;
+    }
+    return n;
+}
+
+void print_result_header() {
+    printf("%4s %8s %10s %9s %10s | %-39s | %-21s | %-39s\n", "ncpu", "tslice", "makespan", "jobs/s", "dispatches",
+           "wait mean/p50/p95/p99 (ms)", "response mean/p95", "turnaround mean/p50/p95/p99 (ms)");
+}
+
+void print_result(const sim_result *r) {
+    printf("%4d %8.3f %10.1f %9.1f %10ld | %9.2f %9.2f %9.2f %9.2f | %10.2f %10.2f | %9.2f %9.2f %9.2f %9.2f\n",
+           r->ncpu, r->tslice_us / 1000.0, r->makespan_us / 1000.0,
+           r->makespan_us > 0 ? njobs * 1e6 / r->makespan_us : 0.0, r->dispatches,
+           r->wait.mean_ms, r->wait.p50_ms, r->wait.p95_ms, r->wait.p99_ms,
+           r->response.mean_ms, r->response.p95_ms,
+           r->turnaround.mean_ms, r->turnaround.p50_ms, r->turnaround.p95_ms, r->turnaround.p99_ms);
+}
+
+void usage(char *program) {
+    fprintf(stderr, "Usage: %s <workload> <NCPU list> <TSLICE(ms) list> [options]\n", program);
+    fprintf(stderr, "  lists are comma separated values or first:last[:step] ranges, e.g. 1,2,4 or 1:20:0.5\n");
+    fprintf(stderr, "  workload lines: arrival_ms cpu_ms [io_every_ms io_ms [priority]]\n");
+    fprintf(stderr, "  --keep-slot-on-block   a job waiting for I/O keeps its slot (default: gives it up until the I/O ends)\n");
+    policy_usage(stderr);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        POLICY_LONG_OPTIONS,
+        {"keep-slot-on-block", no_argument, NULL, 'k'},
+        {"release-on-block", no_argument, NULL, 'b'}, // the default now, kept for old scripts
+        {NULL, 0, NULL, 0},
+    };
+    policy_config config;
+    policy_config_init(&config);
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        if (opt == 'k' || opt == 'b') {
+            release_on_block = opt == 'b';
+        }
+        else if (opt == '?' || !policy_config_option(&config, opt, optarg)) {
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind != 3) usage(argv[0]);
+
+    static double ncpus[MAX_SWEEP], tslices[MAX_SWEEP];
+    int n_ncpu = parse_sweep(argv[optind + 1], ncpus);
+    int n_tslice = parse_sweep(argv[optind + 2], tslices);
+    if (n_ncpu == 0 || n_tslice == 0) usage(argv[0]);
+    for (int i = 0; i < n_ncpu; i++) {
+        if (ncpus[i] < 1) usage(argv[0]);
+    }
+    for (int i = 0; i < n_tslice; i++) {
+        if (tslices[i] * 1000 < 1) usage(argv[0]);
+    }
+    sched_policy *check = policy_create(&config, 1000);
+    if (check == NULL) {
+        fprintf(stderr, "Error: unknown policy %s\n", config.name);
+        usage(argv[0]);
+    }
+
+    load_workload(argv[optind]);
+    printf("%d jobs from %s, policy %s\n", njobs, argv[optind], check->ops->name);
+    policy_destroy(check);
+    print_result_header();
+    for (int c = 0; c < n_ncpu; c++) {
+        for (int t = 0; t < n_tslice; t++) {
+            sim_result result = simulate(&config, (int)ncpus[c], (long)(tslices[t] * 1000 + 0.5));
+            print_result(&result);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Distribution of a per-job time across jobs, shared by the scheduler and the simulator
+
+typedef struct {
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+} time_stats;
+
+static inline int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static inline long percentile(const long *sorted, int n, int p) {
+    int rank = (p * n + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Sorts values_us in place; n must be positive
+static inline time_stats summarize_us(long *values_us, int n) {
+    time_stats stats;
+    long sum = 0;
+    for (int i = 0; i < n; i++) sum += values_us[i];
+    qsort(values_us, n, sizeof(long), compare_long);
+    stats.mean_ms = sum / 1000.0 / n;
+    stats.p50_ms = percentile(values_us, n, 50) / 1000.0;
+    stats.p95_ms = percentile(values_us, n, 95) / 1000.0;
+    stats.p99_ms = percentile(values_us, n, 99) / 1000.0;
+    stats.max_ms = values_us[n - 1] / 1000.0;
+    return stats;
+}
+
+static inline void print_stats_header(FILE *out) {
+    fprintf(out, "%-11s %10s %10s %10s %10s %10s\n", "(ms)", "mean", "p50", "p95", "p99", "max");
+}
+
+static inline void print_stats_row(FILE *out, const char *name, time_stats stats) {
+    fprintf(out, "%-11s %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+            stats.mean_ms, stats.p50_ms, stats.p95_ms, stats.p99_ms, stats.max_ms);
+}
+
+#endif
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Submits many short jobs to the SimpleScheduler and reports the time spent
+# scheduling per tick.
+# Usage: ./stress.sh [JOBS] [NCPU] [TSLICE(ms)] [scheduler options...]
+JOBS=${1:-10000}
+NCPU=${2:-4}
+TSLICE=${3:-1}
+shift 3 2>/dev/null || shift $#
+
+INPUT=$(mktemp)
+trap 'rm -f "$INPUT"' EXIT
+i=0
+while [ "$i" -lt "$JOBS" ]; do
+    echo "submit /bin/true"
+    i=$((i + 1))
+done > "$INPUT"
+
+START=$(date +%s%N)
+TERM=dumb ./scheduler "$NCPU" "$TSLICE" "$@" < "$INPUT" | grep -oE '(Policy|Run queues|Time slice|Ticks|Scheduling|Trace).*'
+END=$(date +%s%N)
+echo "$JOBS jobs on $NCPU CPUs in $(( (END - START) / 1000000 )) ms"
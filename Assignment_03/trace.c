@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "trace.h"
+
+trace_ring tracer;
+
+void trace_init(size_t capacity) {
+    tracer.events = calloc(capacity, sizeof(trace_event));
+    if (tracer.events == NULL) {
+        perror("trace buffer");
+        exit(1);
+    }
+    tracer.capacity = capacity;
+    tracer.count = 0;
+}
+
+void trace_record(trace_type type, int job, int pid, int slot) {
+    if (!trace_enabled()) return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    trace_event *event = &tracer.events[tracer.count % tracer.capacity];
+    event->ts_us = now.tv_sec * 1000000L + now.tv_nsec / 1000;
+    event->job = job;
+    event->pid = pid;
+    event->slot = slot;
+    event->type = type;
+    tracer.count++;
+}
+
+static void write_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            fprintf(out, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", *s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/*
+ * A job's dispatch and its next preempt, block or exit on the same slot
+ * become one complete ("X") event, which the viewers draw as a slice on the
+ * slot's track. Slices are matched per job, so the order in which the
+ * scheduler records a switch does not matter. Submits are instant events on
+ * an extra "run queues" track.
+ */
+bool trace_export(const char *path, int nslots, const char *(*name_of)(int job)) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return false;
+    }
+    size_t first = tracer.count > tracer.capacity ? tracer.count - tracer.capacity : 0;
+    long base_us = tracer.count > 0 ? tracer.events[first % tracer.capacity].ts_us : 0;
+    int njobs = 0;
+    for (size_t i = first; i < tracer.count; i++) {
+        if (tracer.events[i % tracer.capacity].job >= njobs) njobs = tracer.events[i % tracer.capacity].job + 1;
+    }
+    trace_event **open = calloc(njobs + 1, sizeof(trace_event *)); // running slice per job
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int s = 0; s <= nslots; s++) {
+        fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":", s);
+        if (s < nslots) {
+            fprintf(out, "\"CPU slot %d\"}},\n", s);
+        } else {
+            fprintf(out, "\"run queues\"}},\n");
+        }
+    }
+    for (size_t i = first; i < tracer.count; i++) {
+        trace_event *event = &tracer.events[i % tracer.capacity];
+        bool on_slot = event->slot >= 0 && event->slot < nslots;
+        switch (event->type) {
+        case TRACE_SUBMIT:
+            fprintf(out, "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"submit\",\"pid\":0,\"tid\":%d,\"ts\":%ld,"
+                    "\"args\":{\"job\":%d,\"pid\":%d,\"queue\":%d,\"command\":",
+                    nslots, event->ts_us - base_us, event->job, event->pid, event->slot);
+            write_json_string(out, name_of(event->job));
+            fprintf(out, "}},\n");
+            break;
+        case TRACE_DISPATCH:
+            if (on_slot) open[event->job] = event;
+            break;
+        default:
+            if (!on_slot || open[event->job] == NULL || open[event->job]->slot != event->slot) break;
+            trace_event *start = open[event->job];
+            open[event->job] = NULL;
+            fprintf(out, "{\"ph\":\"X\",\"name\":");
+            write_json_string(out, name_of(event->job));
+            fprintf(out, ",\"pid\":0,\"tid\":%d,\"ts\":%ld,\"dur\":%ld,\"args\":{\"job\":%d,\"pid\":%d,\"end\":\"%s\"}},\n",
+                    event->slot, start->ts_us - base_us, event->ts_us - start->ts_us, event->job, event->pid,
+                    event->type == TRACE_PREEMPT ? "preempt" : event->type == TRACE_BLOCK ? "block" : "exit");
+        }
+    }
+    // Close the array with an event that needs no trailing comma
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":0,\"args\":{\"name\":\"SimpleScheduler\"}}\n]}\n");
+    free(open);
+    fclose(out);
+
+    size_t dropped = first;
+    printf("Trace: %zu events written to %s", tracer.count - dropped, path);
+    if (dropped > 0) printf(" (%zu oldest overwritten)", dropped);
+    printf("\n");
+    return true;
+}
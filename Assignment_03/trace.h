@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Opt-in scheduling event trace.
+ *
+ * Events go into a ring buffer allocated once by trace_init(); recording is
+ * a handful of stores and never allocates or does I/O, so it can stay in the
+ * scheduling path. When the ring is full the oldest events are overwritten.
+ * trace_export() writes what is left as Chrome trace JSON (chrome://tracing
+ * or ui.perfetto.dev) with one track per CPU slot.
+ */
+
+typedef enum {
+    TRACE_SUBMIT,   // job entered a run queue for the first time; slot is that queue
+    TRACE_DISPATCH, // job started running on slot
+    TRACE_PREEMPT,  // job was taken off slot and queued again
+    TRACE_BLOCK,    // job left slot because it was blocked
+    TRACE_EXIT,     // job terminated; slot is -1 if it was not running
+} trace_type;
+
+typedef struct {
+    long ts_us; // CLOCK_MONOTONIC
+    int job;    // owner's index for the job
+    int pid;
+    short slot;
+    unsigned char type;
+} trace_event;
+
+typedef struct {
+    trace_event *events;
+    size_t capacity;
+    size_t count; // events recorded so far, including overwritten ones
+} trace_ring;
+
+extern trace_ring tracer;
+
+// Allocates room for capacity events and turns tracing on
+void trace_init(size_t capacity);
+
+static inline bool trace_enabled(void) {
+    return tracer.events != NULL;
+}
+
+void trace_record(trace_type type, int job, int pid, int slot);
+
+// Writes the trace as Chrome JSON; name_of gives the label for a job index
+bool trace_export(const char *path, int nslots, const char *(*name_of)(int job));
+
+#endif
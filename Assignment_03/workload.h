@@ -0,0 +1,41 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Building blocks for the synthetic scheduler jobs. CPU work is measured in
+ * the job's own CPU time, so a job asks for the same amount of work however
+ * often the scheduler stops it; I/O is modelled as a blocking sleep.
+ */
+
+static inline double thread_cpu_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Spins until the job has used ms more milliseconds of CPU
+static inline void burn_cpu_ms(double ms) {
+    double end = thread_cpu_ms() + ms;
+    volatile unsigned long x = 1;
+    while (thread_cpu_ms() < end) {
+        for (int i = 0; i < 1000; i++) x = x * 6364136223846793005UL + 1442695040888963407UL;
+    }
+}
+
+// Blocks for ms milliseconds without using the CPU
+static inline void wait_io_ms(double ms) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000);
+    ts.tv_nsec = (long)((ms - ts.tv_sec * 1000) * 1e6);
+    while (nanosleep(&ts, &ts) == -1);
+}
+
+static inline double arg_ms(int argc, char **argv, int index, double fallback) {
+    return argc > index ? atof(argv[index]) : fallback;
+}
+
+#endif
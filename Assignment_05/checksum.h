@@ -0,0 +1,144 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+/* Parallel result verification for the examples. The data is cut into
+ * blocks (fixed-size chunks of a vector, or the rows of a matrix); each
+ * block is hashed with an xxHash64-style function and checked against the
+ * expected value on the parallel_for_1D workers, then the block hashes are
+ * combined in block order so the checksum does not depend on numThread.
+ * Must be included after simple-multithreader.h.
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+static const uint64_t XXH_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t xxh_rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    return xxh_rotl(acc + input * XXH_PRIME2, 31) * XXH_PRIME1;
+}
+
+static inline uint64_t xxh_merge(uint64_t acc, uint64_t val) {
+    return (acc ^ xxh_round(0, val)) * XXH_PRIME1 + XXH_PRIME4;
+}
+
+static inline uint64_t xxh_read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Hash of one block. The four accumulators are independent, so the 32-byte
+ * stripe loop vectorises and keeps several multiplies in flight.
+ */
+static inline uint64_t block_hash(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint64_t v2 = seed + XXH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+        }
+        h = xxh_rotl(v1, 1) + xxh_rotl(v2, 7) + xxh_rotl(v3, 12) + xxh_rotl(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = seed + XXH_PRIME5;
+    }
+    h += len;
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * XXH_PRIME5;
+        h = xxh_rotl(h, 11) * XXH_PRIME1;
+    }
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+struct VerifyResult {
+    uint64_t checksum;
+    long mismatches;  // elements that differ from the expected value
+    double seconds;
+    size_t bytes;
+};
+
+/* Hashes and verifies the blocks blocks[b][0 .. lengths[b]) of ints, each of
+ * which should hold expected everywhere.
+ */
+VerifyResult verify_blocks(const std::vector<const int*>& blocks, const std::vector<size_t>& lengths,
+                           int expected, int numThread) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    int nBlocks = (int)blocks.size();
+    std::vector<uint64_t> hashes(nBlocks);
+    std::vector<long> mismatches(nBlocks);
+    parallel_for_1D(0, nBlocks, [&](int b) {
+        const int* data = blocks[b];
+        size_t n = lengths[b];
+        hashes[b] = block_hash(data, n * sizeof(int), 0);
+        // Branch-free count over the cache-hot block
+        long bad = 0;
+        for (size_t i = 0; i < n; i++) {
+            bad += data[i] != expected;
+        }
+        mismatches[b] = bad;
+    }, numThread);
+
+    VerifyResult result;
+    result.checksum = 0;
+    result.mismatches = 0;
+    result.bytes = 0;
+    for (int b = 0; b < nBlocks; b++) {
+        result.checksum = xxh_merge(result.checksum ^ (uint64_t)b, hashes[b]);
+        result.mismatches += mismatches[b];
+        result.bytes += lengths[b] * sizeof(int);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    result.seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return result;
+}
+
+// Contiguous array split into 64 KiB blocks
+VerifyResult verify_array(const int* data, size_t n, int expected, int numThread) {
+    const size_t blockElems = 16384;
+    std::vector<const int*> blocks;
+    std::vector<size_t> lengths;
+    for (size_t i = 0; i < n; i += blockElems) {
+        blocks.push_back(data + i);
+        lengths.push_back(std::min(blockElems, n - i));
+    }
+    return verify_blocks(blocks, lengths, expected, numThread);
+}
+
+void print_verify_result(const VerifyResult& r) {
+    printf("Checksum: %016llx, %ld mismatches, verified %.1f MB in %.6f seconds (%.2f GB/s)\n",
+           (unsigned long long)r.checksum, r.mismatches, r.bytes / 1e6, r.seconds,
+           r.seconds > 0 ? r.bytes / r.seconds / 1e9 : 0.0);
+}
+
+#endif
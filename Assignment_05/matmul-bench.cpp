@@ -0,0 +1,100 @@
+#include "simple-multithreader.h"
+#include "matrix-kernels.h"
+#include <time.h>
+#include <sys/mman.h>
+
+// Benchmark of the matrix multiply kernels in matrix-kernels.h
+
+struct Matrix {
+    int n;
+    int* data;
+    int** rows;
+};
+
+Matrix make_matrix(int n, int value) {
+    Matrix m;
+    m.n = n;
+    m.data = (int*)mmap(NULL, sizeof(int) * n * n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m.data == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    m.rows = new int*[n];
+    for (int i = 0; i < n; i++) m.rows[i] = m.data + (size_t)i * n;
+    std::fill(m.data, m.data + (size_t)n * n, value);
+    return m;
+}
+
+void free_matrix(Matrix& m) {
+    munmap(m.data, sizeof(int) * m.n * m.n);
+    delete[] m.rows;
+}
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Best wall time of reps runs of kernel(A, B, C), checking every entry of C equals n
+template <typename Kernel>
+double time_kernel(int n, int reps, Kernel kernel) {
+    Matrix A = make_matrix(n, 1), B = make_matrix(n, 1), C = make_matrix(n, 0);
+    double best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        std::fill(C.data, C.data + (size_t)n * n, 0);
+        double t0 = now_seconds();
+        kernel(A.rows, B.rows, C.rows, n);
+        best = std::min(best, now_seconds() - t0);
+        for (size_t i = 0; i < (size_t)n * n; i++) {
+            if (C.data[i] != n) {
+                fprintf(stderr, "n=%d: wrong result at %zu\n", n, i);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    free_matrix(A);
+    free_matrix(B);
+    free_matrix(C);
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int numThread = argc > 1 ? atoi(argv[1]) : 2;
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+    // 768 has no specialisation and shows the dispatcher's fallback
+    int sizes[] = {256, 512, 768, 1024};
+
+    const int TI = matmul_tiles<int>::TI, TJ = matmul_tiles<int>::TJ, TK = matmul_tiles<int>::TK;
+    printf("%6s %12s %12s %8s\n", "n", "generic(s)", "dispatch(s)", "speedup");
+    for (int n : sizes) {
+        double generic = time_kernel(n, reps, [&](int** A, int** B, int** C, int n) {
+            matmul_generic<int, TI, TJ, TK>(A, B, C, n, numThread);
+        });
+        double dispatched = time_kernel(n, reps, [&](int** A, int** B, int** C, int n) {
+            matmul(A, B, C, n, numThread);
+        });
+        printf("%6d %12.6f %12.6f %7.2fx\n", n, generic, dispatched, generic / dispatched);
+    }
+
+    // Recursive kernels against the parallel_for_2D triple loop from matrix.cpp
+    int recSizes[] = {256, 512, 1000, 1024};
+    printf("\n%6s %12s %12s %12s\n", "n", "2d-loop(s)", "recursive(s)", "strassen(s)");
+    for (int n : recSizes) {
+        double loop = time_kernel(n, 1, [&](int** A, int** B, int** C, int n) {
+            parallel_for_2D(0, n, 0, n, [&](int i, int j) {
+                for (int k = 0; k < n; k++) {
+                    C[i][j] += A[i][k] * B[k][j];
+                }
+            }, numThread);
+        });
+        double recursive = time_kernel(n, reps, [&](int** A, int** B, int** C, int n) {
+            matmul_recursive(A, B, C, n, numThread, false);
+        });
+        double strassen = time_kernel(n, reps, [&](int** A, int** B, int** C, int n) {
+            matmul_recursive(A, B, C, n, numThread, true);
+        });
+        printf("%6d %12.6f %12.6f %12.6f\n", n, loop, recursive, strassen);
+    }
+    return 0;
+}
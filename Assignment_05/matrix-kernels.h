@@ -0,0 +1,296 @@
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+/* Matrix multiply kernels for row-pointer matrices (T** as allocated in
+ * matrix.cpp). All kernels accumulate C += A * B for square n x n matrices
+ * and are parallelised with parallel_for_1D, so this header must be
+ * included after simple-multithreader.h.
+ */
+
+#include <algorithm>
+#include <vector>
+
+/* Generic tiled kernel: tile sizes are compile-time, n is read at run time,
+ * so every tile loop needs a bounds check. Computes rows [r0, r1) of C.
+ */
+template <typename T, int TI, int TJ, int TK>
+void matmul_tiled_rows(T** A, T** B, T** C, int n, int r0, int r1) {
+    for (int ii = r0; ii < r1; ii += TI) {
+        int iend = std::min(ii + TI, r1);
+        for (int kk = 0; kk < n; kk += TK) {
+            int kend = std::min(kk + TK, n);
+            for (int jj = 0; jj < n; jj += TJ) {
+                int jend = std::min(jj + TJ, n);
+                for (int i = ii; i < iend; i++) {
+                    T* c = C[i];
+                    const T* a = A[i];
+                    for (int k = kk; k < kend; k++) {
+                        const T aik = a[k];
+                        const T* b = B[k];
+                        for (int j = jj; j < jend; j++) {
+                            c[j] += aik * b[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Fixed-shape kernel: N and the tile sizes are all compile-time and N is a
+ * multiple of every tile, so the tile bounds vanish and the inner j loop has
+ * a constant trip count of TJ that the compiler unrolls and vectorises.
+ * Computes the row tiles starting at r0 up to r1 (both multiples of TI).
+ */
+template <typename T, int N, int TI, int TJ, int TK>
+void matmul_fixed_rows(T** A, T** B, T** C, int r0, int r1) {
+    static_assert(N % TI == 0 && N % TJ == 0 && N % TK == 0, "N must be a multiple of every tile size");
+    for (int ii = r0; ii < r1; ii += TI) {
+        for (int kk = 0; kk < N; kk += TK) {
+            for (int jj = 0; jj < N; jj += TJ) {
+                for (int i = ii; i < ii + TI; i++) {
+                    T* __restrict c = C[i] + jj;
+                    const T* a = A[i];
+                    for (int k = kk; k < kk + TK; k++) {
+                        const T aik = a[k];
+                        const T* __restrict b = B[k] + jj;
+                        for (int j = 0; j < TJ; j++) {
+                            c[j] += aik * b[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Tile sizes used for a given element type; picked to keep a TK x TJ panel of B in L2
+template <typename T>
+struct matmul_tiles {
+    static const int TI = 16;
+    static const int TJ = 64;
+    static const int TK = 128;
+};
+
+template <typename T, int TI, int TJ, int TK>
+void matmul_generic(T** A, T** B, T** C, int n, int numThread) {
+    int tiles = (n + TI - 1) / TI;
+    parallel_for_1D(0, tiles, [&](int t) {
+        matmul_tiled_rows<T, TI, TJ, TK>(A, B, C, n, t * TI, std::min((t + 1) * TI, n));
+    }, numThread);
+}
+
+template <typename T, int N, int TI, int TJ, int TK>
+void matmul_fixed(T** A, T** B, T** C, int numThread) {
+    parallel_for_1D(0, N / TI, [&](int t) {
+        matmul_fixed_rows<T, N, TI, TJ, TK>(A, B, C, t * TI, (t + 1) * TI);
+    }, numThread);
+}
+
+/* Runs the specialised instantiation for n if one was compiled in and returns
+ * true, otherwise leaves C untouched and returns false.
+ */
+template <typename T>
+bool matmul_specialized(T** A, T** B, T** C, int n, int numThread) {
+    const int TI = matmul_tiles<T>::TI;
+    const int TJ = matmul_tiles<T>::TJ;
+    const int TK = matmul_tiles<T>::TK;
+    switch (n) {
+        case 256:  matmul_fixed<T, 256, TI, TJ, TK>(A, B, C, numThread);  return true;
+        case 512:  matmul_fixed<T, 512, TI, TJ, TK>(A, B, C, numThread);  return true;
+        case 1024: matmul_fixed<T, 1024, TI, TJ, TK>(A, B, C, numThread); return true;
+        case 2048: matmul_fixed<T, 2048, TI, TJ, TK>(A, B, C, numThread); return true;
+        default:   return false;
+    }
+}
+
+// Dispatcher: specialised kernel when the shape matches, generic tiled kernel otherwise
+template <typename T>
+void matmul(T** A, T** B, T** C, int n, int numThread) {
+    if (!matmul_specialized(A, B, C, n, numThread)) {
+        matmul_generic<T, matmul_tiles<T>::TI, matmul_tiles<T>::TJ, matmul_tiles<T>::TK>(A, B, C, n, numThread);
+    }
+}
+
+/* Cache-oblivious recursive multiply. Blocks are addressed through views
+ * into row-pointer matrices so quadrants and temporaries need no copies.
+ */
+template <typename T>
+struct MatView {
+    T** rows;
+    int r;
+    int c;
+
+    T* row(int i) const { return rows[r + i] + c; }
+    MatView sub(int i, int j) const {
+        MatView v = {rows, r + i, c + j};
+        return v;
+    }
+};
+
+// C[m x n] += A[m x k] * B[k x n] for blocks small enough to sit in L1
+template <typename T>
+void matmul_leaf(MatView<T> A, MatView<T> B, MatView<T> C, int m, int k, int n) {
+    for (int i = 0; i < m; i++) {
+        T* c = C.row(i);
+        const T* a = A.row(i);
+        for (int p = 0; p < k; p++) {
+            const T aip = a[p];
+            const T* b = B.row(p);
+            for (int j = 0; j < n; j++) {
+                c[j] += aip * b[j];
+            }
+        }
+    }
+}
+
+/* Halves the largest of m, k, n until every dimension fits in LEAF. Splits
+ * of m and n write disjoint parts of C; a split of k accumulates both halves
+ * into the same block one after the other.
+ */
+template <typename T, int LEAF>
+void matmul_recursive_serial(MatView<T> A, MatView<T> B, MatView<T> C, int m, int k, int n) {
+    if (m <= LEAF && k <= LEAF && n <= LEAF) {
+        matmul_leaf(A, B, C, m, k, n);
+    } else if (m >= k && m >= n) {
+        int h = m / 2;
+        matmul_recursive_serial<T, LEAF>(A, B, C, h, k, n);
+        matmul_recursive_serial<T, LEAF>(A.sub(h, 0), B, C.sub(h, 0), m - h, k, n);
+    } else if (n >= k) {
+        int h = n / 2;
+        matmul_recursive_serial<T, LEAF>(A, B, C, m, k, h);
+        matmul_recursive_serial<T, LEAF>(A, B.sub(0, h), C.sub(0, h), m, k, n - h);
+    } else {
+        int h = k / 2;
+        matmul_recursive_serial<T, LEAF>(A, B, C, m, h, n);
+        matmul_recursive_serial<T, LEAF>(A.sub(0, h), B.sub(h, 0), C, m, k - h, n);
+    }
+}
+
+template <typename T>
+struct MatmulTask {
+    MatView<T> A, B, C;
+    int m, k, n;
+};
+
+/* Top of the recursion: splits only along m and n, whose halves are
+ * independent, for depth levels and records each piece as a task.
+ */
+template <typename T, int LEAF>
+void matmul_split_tasks(MatView<T> A, MatView<T> B, MatView<T> C, int m, int k, int n, int depth,
+                        std::vector<MatmulTask<T> >& tasks) {
+    if (depth == 0 || (m <= LEAF && n <= LEAF)) {
+        MatmulTask<T> t = {A, B, C, m, k, n};
+        tasks.push_back(t);
+    } else if (m >= n) {
+        int h = m / 2;
+        matmul_split_tasks<T, LEAF>(A, B, C, h, k, n, depth - 1, tasks);
+        matmul_split_tasks<T, LEAF>(A.sub(h, 0), B, C.sub(h, 0), m - h, k, n, depth - 1, tasks);
+    } else {
+        int h = n / 2;
+        matmul_split_tasks<T, LEAF>(A, B, C, m, k, h, depth - 1, tasks);
+        matmul_split_tasks<T, LEAF>(A, B.sub(0, h), C.sub(0, h), m, k, n - h, depth - 1, tasks);
+    }
+}
+
+// Enough levels that each worker gets about four tasks to balance the load
+inline int matmul_split_depth(int numThread) {
+    int depth = 0;
+    while ((1 << depth) < 4 * numThread) depth++;
+    return depth;
+}
+
+template <typename T, int LEAF>
+void matmul_run_tasks(std::vector<MatmulTask<T> >& tasks, int numThread) {
+    parallel_for_1D(0, (int)tasks.size(), [&](int t) {
+        MatmulTask<T>& task = tasks[t];
+        matmul_recursive_serial<T, LEAF>(task.A, task.B, task.C, task.m, task.k, task.n);
+    }, numThread);
+}
+
+/* One Strassen level on an even n: seven half-size products instead of
+ * eight, each computed by the cache-oblivious recursion. All seven products
+ * are split into a single task list so every worker stays busy.
+ */
+template <typename T, int LEAF>
+void matmul_strassen(MatView<T> A, MatView<T> B, MatView<T> C, int n, int numThread) {
+    int h = n / 2;
+    // S1..S10 operand sums followed by the products M1..M7
+    const int nTemps = 17;
+    std::vector<T> storage((size_t)nTemps * h * h, 0);
+    std::vector<T*> rowPtrs((size_t)nTemps * h);
+    for (size_t i = 0; i < rowPtrs.size(); i++) rowPtrs[i] = &storage[i * h];
+    std::vector<MatView<T> > tmp(nTemps);
+    for (int t = 0; t < nTemps; t++) {
+        MatView<T> v = {&rowPtrs[(size_t)t * h], 0, 0};
+        tmp[t] = v;
+    }
+    MatView<T> A11 = A, A12 = A.sub(0, h), A21 = A.sub(h, 0), A22 = A.sub(h, h);
+    MatView<T> B11 = B, B12 = B.sub(0, h), B21 = B.sub(h, 0), B22 = B.sub(h, h);
+    MatView<T>* S = &tmp[0];   // S[0]..S[9] hold S1..S10
+    MatView<T>* M = &tmp[10];  // M[0]..M[6] hold M1..M7
+
+    parallel_for_1D(0, h, [&](int i) {
+        const T *a11 = A11.row(i), *a12 = A12.row(i), *a21 = A21.row(i), *a22 = A22.row(i);
+        const T *b11 = B11.row(i), *b12 = B12.row(i), *b21 = B21.row(i), *b22 = B22.row(i);
+        T *s1 = S[0].row(i), *s2 = S[1].row(i), *s3 = S[2].row(i), *s4 = S[3].row(i), *s5 = S[4].row(i);
+        T *s6 = S[5].row(i), *s7 = S[6].row(i), *s8 = S[7].row(i), *s9 = S[8].row(i), *s10 = S[9].row(i);
+        for (int j = 0; j < h; j++) {
+            s1[j] = a11[j] + a22[j];
+            s2[j] = b11[j] + b22[j];
+            s3[j] = a21[j] + a22[j];
+            s4[j] = b12[j] - b22[j];
+            s5[j] = b21[j] - b11[j];
+            s6[j] = a11[j] + a12[j];
+            s7[j] = a21[j] - a11[j];
+            s8[j] = b11[j] + b12[j];
+            s9[j] = a12[j] - a22[j];
+            s10[j] = b21[j] + b22[j];
+        }
+    }, numThread);
+
+    std::vector<MatmulTask<T> > tasks;
+    int depth = matmul_split_depth((numThread + 6) / 7);
+    matmul_split_tasks<T, LEAF>(S[0], S[1], M[0], h, h, h, depth, tasks);
+    matmul_split_tasks<T, LEAF>(S[2], B11, M[1], h, h, h, depth, tasks);
+    matmul_split_tasks<T, LEAF>(A11, S[3], M[2], h, h, h, depth, tasks);
+    matmul_split_tasks<T, LEAF>(A22, S[4], M[3], h, h, h, depth, tasks);
+    matmul_split_tasks<T, LEAF>(S[5], B22, M[4], h, h, h, depth, tasks);
+    matmul_split_tasks<T, LEAF>(S[6], S[7], M[5], h, h, h, depth, tasks);
+    matmul_split_tasks<T, LEAF>(S[8], S[9], M[6], h, h, h, depth, tasks);
+    matmul_run_tasks<T, LEAF>(tasks, numThread);
+
+    MatView<T> C11 = C, C12 = C.sub(0, h), C21 = C.sub(h, 0), C22 = C.sub(h, h);
+    parallel_for_1D(0, h, [&](int i) {
+        const T *m1 = M[0].row(i), *m2 = M[1].row(i), *m3 = M[2].row(i), *m4 = M[3].row(i);
+        const T *m5 = M[4].row(i), *m6 = M[5].row(i), *m7 = M[6].row(i);
+        T *c11 = C11.row(i), *c12 = C12.row(i), *c21 = C21.row(i), *c22 = C22.row(i);
+        for (int j = 0; j < h; j++) {
+            c11[j] += m1[j] + m4[j] - m5[j] + m7[j];
+            c12[j] += m3[j] + m5[j];
+            c21[j] += m2[j] + m4[j];
+            c22[j] += m1[j] - m2[j] + m3[j] + m6[j];
+        }
+    }, numThread);
+}
+
+// Smallest n for which the Strassen level pays for its extra additions
+const int MATMUL_STRASSEN_MIN = 512;
+
+/* Recursive multiply of n x n matrices. With strassen set, large even sizes
+ * take one Strassen level before falling back to the plain recursion.
+ */
+template <typename T>
+void matmul_recursive(T** A, T** B, T** C, int n, int numThread, bool strassen) {
+    const int LEAF = 64;
+    MatView<T> a = {A, 0, 0}, b = {B, 0, 0}, c = {C, 0, 0};
+    if (strassen && n % 2 == 0 && n >= MATMUL_STRASSEN_MIN) {
+        matmul_strassen<T, LEAF>(a, b, c, n, numThread);
+        return;
+    }
+    std::vector<MatmulTask<T> > tasks;
+    matmul_split_tasks<T, LEAF>(a, b, c, n, n, n, matmul_split_depth(numThread), tasks);
+    matmul_run_tasks<T, LEAF>(tasks, numThread);
+}
+
+#endif
@@ -1,93 +1,30 @@
 #include "simple-multithreader.h"
+#include "matrix-kernels.h"
+#include "checksum.h"
 #include <assert.h>
 #include <pthread.h>
 #include <time.h>
 #include <sys/mman.h>
 
-struct ThreadArg {
-    int start;
-    int end;
-    int cols;
-    std::function<void(int)> func1;
-    std::function<void(int, int)> func2;
-};
-
-std::list<void*> allocatedMemory;
-
-void* thread_func1(void* arg) {
-    ThreadArg* threadArg = (ThreadArg*)(arg);
-    for (int i = threadArg->start; i < threadArg->end; i++) {
-        threadArg->func1(i);
-    }
-    return NULL;
-}
-
-void* thread_func2(void* arg) {
-    ThreadArg* threadArg = (ThreadArg*)(arg);
-    for (int i = threadArg->start; i <= threadArg->end; i++) {
-        threadArg->func2(i / threadArg->cols, i % threadArg->cols);
-    }
-    return NULL;
-}
-
-void parallel_for_2D(int s1, int e1, int s2, int e2, std::function<void(int, int)> func, int numThread) {
-    int rows = e1 - s1;
-    int cols = e2 - s2;
-    int totalSize = rows * cols;
-    int chunkSize = (totalSize + numThread - 1) / numThread;
-
-    pthread_t threads[numThread];
-    ThreadArg args[numThread];
-
-    for (int i = 0; i < numThread; ++i) {
-        int start = i * chunkSize;
-        int end = std::min(start + chunkSize - 1, totalSize - 1);
-
-        args[i].start = start;
-        args[i].end = end;
-        args[i].cols = cols;
-
-        args[i].func2 = func;
-        pthread_create(&threads[i], NULL, thread_func2, &args[i]);
-    }
-
-    for (int i = 0; i < numThread; ++i) {
-        pthread_join(threads[i], NULL);
-    }
-}
-
-void parallel_for_1D(int start, int end, std::function<void(int)> func, int numThread) {
-    int totalSize = end - start;
-    int chunkSize = (totalSize + numThread - 1) / numThread;
-
-    pthread_t threads[numThread];
-    ThreadArg args[numThread];
-
-    for (int i = 0; i < numThread; ++i) {
-        args[i].start = start + i * chunkSize;
-        args[i].end = std::min(start + (i + 1) * chunkSize, end);
-        args[i].func1 = func;
-        pthread_create(&threads[i], NULL, thread_func1, &args[i]);
-    }
-
-    for (int i = 0; i < numThread; ++i) {
-        pthread_join(threads[i], NULL);
-    }
-}
+std::list<std::pair<void*, size_t> > allocatedMemory;
+pthread_mutex_t allocatedMemoryLock = PTHREAD_MUTEX_INITIALIZER;
 
+// Called from parallel_for_1D workers, so the shared list is guarded
 void* allocateMemory(size_t size) {
     void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     if (ptr == MAP_FAILED) {
         perror("mmap");
         exit(EXIT_FAILURE);
     }
-    allocatedMemory.push_back(ptr);
+    pthread_mutex_lock(&allocatedMemoryLock);
+    allocatedMemory.push_back(std::make_pair(ptr, size));
+    pthread_mutex_unlock(&allocatedMemoryLock);
     return ptr;
 }
 
 void freeAllocatedMemory() {
-    for (void* ptr : allocatedMemory) {
-        munmap(ptr, sizeof(void*) * allocatedMemory.size());
+    for (auto& block : allocatedMemory) {
+        munmap(block.first, block.second);
     }
     allocatedMemory.clear();
 }
@@ -96,6 +33,9 @@ int main(int argc, char** argv) {
     // Initialize problem size
     int numThread = argc > 1 ? atoi(argv[1]) : 2;
     int size = argc > 2 ? atoi(argv[2]) : 1024;
+    // "2d" runs the parallel_for_2D triple loop, "tiled" the dispatched tiled kernels,
+    // "recursive" and "strassen" the cache-oblivious recursion
+    const char* kernel = argc > 3 ? argv[3] : "2d";
 
     // Allocate matrices
     int** A = (int**)allocateMemory(sizeof(int*) * size);
@@ -114,21 +54,30 @@ int main(int argc, char** argv) {
     clock_t startTime = clock();
 
     // Start the parallel multiplication of two matrices
-    parallel_for_2D(0, size, 0, size, [&](int i, int j) {
-        for (int k = 0; k < size; k++) {
-            C[i][j] += A[i][k] * B[k][j];
-        }
-    }, numThread);
+    if (strcmp(kernel, "tiled") == 0) {
+        matmul(A, B, C, size, numThread);
+    } else if (strcmp(kernel, "recursive") == 0 || strcmp(kernel, "strassen") == 0) {
+        matmul_recursive(A, B, C, size, numThread, strcmp(kernel, "strassen") == 0);
+    } else {
+        parallel_for_2D(0, size, 0, size, [&](int i, int j) {
+            for (int k = 0; k < size; k++) {
+                C[i][j] += A[i][k] * B[k][j];
+            }
+        }, numThread);
+    }
 
     clock_t endTime = clock();
     double execTime = (double)(endTime - startTime) / CLOCKS_PER_SEC;
     printf("Execution Time: %.6f seconds\n", execTime);
 
-    // Verify the result matrix
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            assert(C[i][j] == size);
-        }
+    // Verify the result matrix in parallel, one block per row
+    std::vector<const int*> rows(C, C + size);
+    std::vector<size_t> lengths(size, size);
+    VerifyResult check = verify_blocks(rows, lengths, size, numThread);
+    print_verify_result(check);
+    if (check.mismatches != 0) {
+        fprintf(stderr, "Test Failed: %ld wrong elements\n", check.mismatches);
+        exit(EXIT_FAILURE);
     }
     printf("Test Success.\n");
 
@@ -0,0 +1,70 @@
+#include "simple-multithreader.h"
+#include "task-queue.h"
+#include <time.h>
+
+// Throughput and submit-to-start latency of task_pool with 1..N external producers
+
+static long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+struct ProducerArg {
+    task_pool* pool;
+    int id;
+    int tasks;
+    long* latency;              // one slot per task, written by the worker that runs it
+    std::atomic<int>* done;
+};
+
+void* producer_main(void* arg) {
+    ProducerArg* p = (ProducerArg*)arg;
+    long* latency = p->latency + (size_t)p->id * p->tasks;
+    std::atomic<int>* done = p->done;
+    for (int i = 0; i < p->tasks; i++) {
+        long submitted = now_ns();
+        long* slot = &latency[i];
+        p->pool->submit([slot, submitted, done]() {
+            *slot = now_ns() - submitted;
+            done->fetch_add(1, std::memory_order_release);
+        });
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    int numThread = argc > 1 ? atoi(argv[1]) : 2;
+    int maxProducers = argc > 2 ? atoi(argv[2]) : 4;
+    int tasksPerProducer = argc > 3 ? atoi(argv[3]) : 200000;
+
+    task_pool pool(numThread);
+    std::vector<long> latency((size_t)maxProducers * tasksPerProducer);
+
+    printf("%9s %14s %10s %10s %10s\n", "producers", "tasks/s", "p50(us)", "p99(us)", "max(us)");
+    for (int producers = 1; producers <= maxProducers; producers++) {
+        int total = producers * tasksPerProducer;
+        std::atomic<int> done(0);
+        std::vector<pthread_t> threads(producers);
+        std::vector<ProducerArg> args(producers);
+
+        long start = now_ns();
+        for (int i = 0; i < producers; i++) {
+            ProducerArg a = {&pool, i, tasksPerProducer, latency.data(), &done};
+            args[i] = a;
+            pthread_create(&threads[i], NULL, producer_main, &args[i]);
+        }
+        for (int i = 0; i < producers; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        while (done.load(std::memory_order_acquire) < total) {
+            sched_yield();
+        }
+        double elapsed = (now_ns() - start) / 1e9;
+
+        std::sort(latency.begin(), latency.begin() + total);
+        printf("%9d %14.0f %10.2f %10.2f %10.2f\n", producers, total / elapsed,
+               latency[total / 2] / 1e3, latency[(size_t)total * 99 / 100] / 1e3, latency[total - 1] / 1e3);
+    }
+    return 0;
+}
@@ -3,9 +3,250 @@
 #include <functional>
 #include <stdlib.h>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
 
 int user_main(int argc, char **argv);
 
+// Per-thread work description shared by the parallel_for variants
+struct ThreadArg {
+    int start;
+    int end;
+    int s1;
+    int s2;
+    int cols;
+    std::function<void(int)> func1;
+    std::function<void(int, int)> func2;
+};
+
+static void* thread_func1(void* arg) {
+    ThreadArg* threadArg = (ThreadArg*)(arg);
+    for (int i = threadArg->start; i < threadArg->end; i++) {
+        threadArg->func1(i);
+    }
+    return NULL;
+}
+
+static void* thread_func2(void* arg) {
+    ThreadArg* threadArg = (ThreadArg*)(arg);
+    for (int i = threadArg->start; i <= threadArg->end; i++) {
+        threadArg->func2(threadArg->s1 + i / threadArg->cols, threadArg->s2 + i % threadArg->cols);
+    }
+    return NULL;
+}
+
+/* Runs func(i, j) for every (i, j) in [s1, e1) x [s2, e2), splitting the
+ * flattened iteration space into numThread contiguous chunks.
+ */
+void parallel_for_2D(int s1, int e1, int s2, int e2, std::function<void(int, int)> func, int numThread) {
+    int rows = e1 - s1;
+    int cols = e2 - s2;
+    int totalSize = rows * cols;
+    int chunkSize = (totalSize + numThread - 1) / numThread;
+
+    pthread_t threads[numThread];
+    ThreadArg args[numThread];
+
+    for (int i = 0; i < numThread; ++i) {
+        int start = i * chunkSize;
+        int end = std::min(start + chunkSize - 1, totalSize - 1);
+
+        args[i].start = start;
+        args[i].end = end;
+        args[i].s1 = s1;
+        args[i].s2 = s2;
+        args[i].cols = cols;
+
+        args[i].func2 = func;
+        pthread_create(&threads[i], NULL, thread_func2, &args[i]);
+    }
+
+    for (int i = 0; i < numThread; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/* Runs func(i) for every i in [start, end), splitting the range into
+ * numThread contiguous chunks.
+ */
+void parallel_for_1D(int start, int end, std::function<void(int)> func, int numThread) {
+    int totalSize = end - start;
+    int chunkSize = (totalSize + numThread - 1) / numThread;
+
+    pthread_t threads[numThread];
+    ThreadArg args[numThread];
+
+    for (int i = 0; i < numThread; ++i) {
+        args[i].start = start + i * chunkSize;
+        args[i].end = std::min(start + (i + 1) * chunkSize, end);
+        args[i].func1 = func;
+        pthread_create(&threads[i], NULL, thread_func1, &args[i]);
+    }
+
+    for (int i = 0; i < numThread; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/* Non-blocking parallel regions. parallel_for_1D_async/parallel_for_2D_async
+ * start detached worker threads and return immediately with a handle. The
+ * last worker to finish marks the region done and writes to the handle's
+ * eventfd, which stays readable from then on, so an event loop can poll
+ * fd() next to its other descriptors. Under C++20 the handle can also be
+ * co_await'ed; the awaiting coroutine is resumed on the last worker thread.
+ */
+class parallel_handle {
+    struct State {
+        int efd;
+        std::atomic<int> remaining;
+        std::atomic<int> phase;  // RUNNING, AWAITED or DONE
+        void* continuation;      // coroutine frame to resume, set before AWAITED
+        ~State() { close(efd); }
+    };
+    enum { RUNNING, AWAITED, DONE };
+
+    struct AsyncArg {
+        std::shared_ptr<State> state;
+        ThreadArg work;
+        bool twoD;
+    };
+
+    std::shared_ptr<State> state;
+
+    static void finish(State* st) {
+        if (st->remaining.fetch_sub(1) != 1) return;
+        int previous = st->phase.exchange(DONE);
+        eventfd_write(st->efd, 1);
+        if (previous == AWAITED) {
+#if defined(__cpp_impl_coroutine)
+            std::coroutine_handle<>::from_address(st->continuation).resume();
+#endif
+        }
+    }
+
+    static void* thread_main(void* arg) {
+        AsyncArg* a = (AsyncArg*)arg;
+        if (a->twoD) {
+            thread_func2(&a->work);
+        } else {
+            thread_func1(&a->work);
+        }
+        // Keep the state alive past delete in case the handle is already gone
+        std::shared_ptr<State> st = a->state;
+        delete a;
+        finish(st.get());
+        return NULL;
+    }
+
+    void spawn(ThreadArg& work, bool twoD) {
+        AsyncArg* a = new AsyncArg;
+        a->state = state;
+        a->work = work;
+        a->twoD = twoD;
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attr, thread_main, a) != 0) {
+            // Run the chunk inline rather than lose it
+            thread_main(a);
+        }
+        pthread_attr_destroy(&attr);
+    }
+
+    explicit parallel_handle(int numThread) : state(new State) {
+        state->efd = eventfd(0, EFD_CLOEXEC);
+        if (state->efd < 0) {
+            perror("eventfd");
+            exit(EXIT_FAILURE);
+        }
+        state->remaining.store(numThread);
+        state->phase.store(RUNNING);
+        state->continuation = NULL;
+    }
+
+    friend parallel_handle parallel_for_1D_async(int, int, std::function<void(int)>, int);
+    friend parallel_handle parallel_for_2D_async(int, int, int, int, std::function<void(int, int)>, int);
+
+public:
+    parallel_handle(parallel_handle&& other) : state(std::move(other.state)) {}
+    parallel_handle(const parallel_handle&) = delete;
+    parallel_handle& operator=(const parallel_handle&) = delete;
+
+    // Blocks until the region is done, so no worker outlives the caller's captures
+    ~parallel_handle() {
+        if (state) wait();
+    }
+
+    // Readable once the region has finished; never needs to be read or closed
+    int fd() const { return state->efd; }
+
+    bool ready() const { return state->phase.load() == DONE; }
+
+    void wait() const {
+        struct pollfd pfd = {state->efd, POLLIN, 0};
+        while (!ready()) {
+            poll(&pfd, 1, -1);
+        }
+    }
+
+#if defined(__cpp_impl_coroutine)
+    bool await_ready() const { return ready(); }
+
+    // Returns false (resume immediately) if the workers finished meanwhile
+    bool await_suspend(std::coroutine_handle<> h) {
+        state->continuation = h.address();
+        int expected = RUNNING;
+        return state->phase.compare_exchange_strong(expected, AWAITED);
+    }
+
+    void await_resume() const {}
+#endif
+};
+
+parallel_handle parallel_for_1D_async(int start, int end, std::function<void(int)> func, int numThread) {
+    int totalSize = end - start;
+    int chunkSize = (totalSize + numThread - 1) / numThread;
+
+    parallel_handle handle(numThread);
+    for (int i = 0; i < numThread; ++i) {
+        ThreadArg work;
+        work.start = start + i * chunkSize;
+        work.end = std::min(start + (i + 1) * chunkSize, end);
+        work.func1 = func;
+        handle.spawn(work, false);
+    }
+    return handle;
+}
+
+parallel_handle parallel_for_2D_async(int s1, int e1, int s2, int e2, std::function<void(int, int)> func, int numThread) {
+    int rows = e1 - s1;
+    int cols = e2 - s2;
+    int totalSize = rows * cols;
+    int chunkSize = (totalSize + numThread - 1) / numThread;
+
+    parallel_handle handle(numThread);
+    for (int i = 0; i < numThread; ++i) {
+        ThreadArg work;
+        work.start = i * chunkSize;
+        work.end = std::min(work.start + chunkSize - 1, totalSize - 1);
+        work.s1 = s1;
+        work.s2 = s2;
+        work.cols = cols;
+        work.func2 = func;
+        handle.spawn(work, true);
+    }
+    return handle;
+}
+
 /* Demonstration on how to pass lambda as parameter.
  * "&&" means r-value reference. You may read about it online.
  */
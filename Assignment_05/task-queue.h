@@ -0,0 +1,207 @@
+#ifndef TASK_QUEUE_H
+#define TASK_QUEUE_H
+
+/* Lock-free task submission for code running outside a parallel region.
+ *
+ * mpmc_queue is a bounded multi-producer/multi-consumer ring in the style of
+ * Dmitry Vyukov's queue: every cell carries a sequence number that tells a
+ * producer whether the cell is free for its ticket and a consumer whether the
+ * cell holds the value for its ticket, so neither side ever takes a lock.
+ *
+ * task_pool owns a fixed set of worker threads that consume closures from
+ * such a queue. Any thread may call submit(); idle workers sleep on a futex
+ * and are only woken when a producer sees that someone is asleep.
+ */
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+template <typename T>
+class mpmc_queue {
+public:
+    // capacity is rounded up to a power of two
+    explicit mpmc_queue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        cells = new cell[size];
+        for (size_t i = 0; i < size; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    ~mpmc_queue() { delete[] cells; }
+
+    // Returns false without blocking when the ring is full
+    bool try_push(T&& value) {
+        cell* c;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            c = &cells[pos & mask];
+            size_t seq = c->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        c->value = std::move(value);
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false without blocking when the ring is empty
+    bool try_pop(T& value) {
+        cell* c;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            c = &cells[pos & mask];
+            size_t seq = c->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(c->value);
+        c->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    mpmc_queue(const mpmc_queue&);
+    mpmc_queue& operator=(const mpmc_queue&);
+
+    cell* cells;
+    size_t mask;
+    // Producers and consumers each hammer their own index, keep them on separate lines
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+};
+
+static inline void futex_wait(std::atomic<int>* addr, int expected) {
+    syscall(SYS_futex, (int*)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void futex_wake(std::atomic<int>* addr, int count) {
+    syscall(SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+class task_pool {
+public:
+    task_pool(int numThread, size_t capacity = 1024) : queue(capacity), workers(numThread) {
+        wakeSeq.store(0);
+        sleepers.store(0);
+        stopping.store(false);
+        for (int i = 0; i < numThread; i++) {
+            pthread_create(&workers[i], NULL, worker_main, this);
+        }
+    }
+
+    // Runs every task already submitted, then joins the workers
+    ~task_pool() {
+        stopping.store(true);
+        wakeSeq.fetch_add(1);
+        futex_wake(&wakeSeq, (int)workers.size());
+        for (size_t i = 0; i < workers.size(); i++) {
+            pthread_join(workers[i], NULL);
+        }
+    }
+
+    // Non-blocking submission; returns false when the queue is full
+    bool try_submit(std::function<void()>&& task) {
+        if (!queue.try_push(std::move(task))) return false;
+        wake_one();
+        return true;
+    }
+
+    // Submission that yields until there is room in the queue
+    void submit(std::function<void()> task) {
+        while (!queue.try_push(std::move(task))) {
+            sched_yield();
+        }
+        wake_one();
+    }
+
+    int size() const { return (int)workers.size(); }
+
+private:
+    // Spins before parking so back-to-back submissions avoid the futex entirely
+    static const int SPIN_LIMIT = 256;
+
+    /* Dekker-style handshake with the worker's park(): the producer publishes
+     * the task and then looks for sleepers, the worker announces itself as a
+     * sleeper and then looks for tasks. The fences make sure at least one side
+     * sees the other, so a wakeup is never lost.
+     */
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+            wakeSeq.fetch_add(1, std::memory_order_release);
+            futex_wake(&wakeSeq, 1);
+        }
+    }
+
+    static void* worker_main(void* arg) {
+        task_pool* pool = (task_pool*)arg;
+        std::function<void()> task;
+        for (;;) {
+            bool found = false;
+            for (int spin = 0; spin < SPIN_LIMIT && !found; spin++) {
+                found = pool->queue.try_pop(task);
+            }
+            if (found) {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            int seq = pool->wakeSeq.load(std::memory_order_acquire);
+            pool->sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (pool->queue.try_pop(task)) {
+                pool->sleepers.fetch_sub(1, std::memory_order_relaxed);
+                task();
+                task = nullptr;
+                continue;
+            }
+            if (pool->stopping.load()) {
+                pool->sleepers.fetch_sub(1, std::memory_order_relaxed);
+                return NULL;
+            }
+            futex_wait(&pool->wakeSeq, seq);
+            pool->sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    task_pool(const task_pool&);
+    task_pool& operator=(const task_pool&);
+
+    mpmc_queue<std::function<void()> > queue;
+    std::vector<pthread_t> workers;
+    std::atomic<int> wakeSeq;   // futex word, bumped on every wakeup
+    std::atomic<int> sleepers;  // workers parked or about to park
+    std::atomic<bool> stopping;
+};
+
+#endif
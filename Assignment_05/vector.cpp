@@ -1,4 +1,5 @@
 #include "simple-multithreader.h"
+#include "checksum.h"
 #include <assert.h>
 #include <pthread.h>
 #include <time.h>
@@ -31,42 +32,6 @@ void append_node(ListNode*& head, ListNode* newNode) {
     }
 }
 
-// Thread argument structure
-typedef struct {
-    int start;
-    int end;
-    std::function<void(int)> func;
-} ThreadArg;
-
-void* thread_func(void* arg) {
-    ThreadArg* threadArg = (ThreadArg*)(arg);
-
-    for (int i = threadArg->start; i < threadArg->end; i++) {
-        threadArg->func(i);
-    }
-
-    return NULL;
-}
-
-void parallel_for_1D(int start, int end, std::function<void(int)> func, int numThread) {
-    int totalSize = end - start;
-    int chunkSize = (totalSize + numThread - 1) / numThread;
-
-    pthread_t threads[numThread];
-    ThreadArg args[numThread];
-
-    for (int i = 0; i < numThread; ++i) {
-        args[i].start = start + i * chunkSize;
-        args[i].end = std::min(start + (i + 1) * chunkSize, end);
-        args[i].func = func;
-        pthread_create(&threads[i], NULL, thread_func, &args[i]);
-    }
-
-    for (int i = 0; i < numThread; ++i) {
-        pthread_join(threads[i], NULL);
-    }
-}
-
 int main(int argc, char** argv) {
     // Initialize problem size
     int numThread = argc > 1 ? atoi(argv[1]) : 2;
@@ -104,8 +69,13 @@ int main(int argc, char** argv) {
     ListNode* resultNode = create_node(C, size);
     append_node(resultList, resultNode);
 
-    // Verify the result vector
-    for (int i = 0; i < size; i++) assert(C[i] == 2);
+    // Verify the result vector in parallel; unlike assert this also runs under NDEBUG
+    VerifyResult check = verify_array(C, size, 2, numThread);
+    print_verify_result(check);
+    if (check.mismatches != 0) {
+        fprintf(stderr, "Test Failed: %ld wrong elements\n", check.mismatches);
+        exit(EXIT_FAILURE);
+    }
 
     printf("Test Success\n");
 